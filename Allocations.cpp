@@ -0,0 +1,53 @@
+/*
+ * File:   Allocations.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Allocations.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+using namespace std;
+
+static atomic<uint64_t> allocations(0);
+static atomic<uint64_t> allocatedBytes(0);
+static atomic<bool> counting(false);
+
+AllocationCounters allocationCounters()
+{
+    return {allocations.load(memory_order_relaxed), allocatedBytes.load(memory_order_relaxed)};
+}
+
+void startAllocationCount()
+{
+    counting.store(true, memory_order_relaxed);
+}
+
+// The array and nothrow forms end up here.
+void * operator new(size_t size)
+{
+    if (counting.load(memory_order_relaxed))
+    {
+        allocations.fetch_add(1, memory_order_relaxed);
+        allocatedBytes.fetch_add(size, memory_order_relaxed);
+    }
+    void * p = malloc(size ? size : 1);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void * p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void * p, size_t) noexcept
+{
+    free(p);
+}
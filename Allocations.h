@@ -0,0 +1,30 @@
+/*
+ * File:   Allocations.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <cstdint>
+
+/*
+ * Heap allocations made through operator new since startAllocationCount(),
+ * in all threads. The transforms reuse their buffers, so these should not grow
+ * with the number of records.
+ */
+struct AllocationCounters
+{
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+AllocationCounters allocationCounters();
+// Until it is called, operator new only tests a flag and calls malloc().
+void startAllocationCount();
+
+#endif // ALLOCATIONS_H
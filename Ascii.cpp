@@ -0,0 +1,340 @@
+/*
+ * File:   Ascii.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Ascii.h"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ASCII_X86
+#endif
+
+// Bytes converted on the stack before being appended.
+#define ASCII_CASE_BLOCK 1024
+
+using namespace std;
+
+static size_t printablePrefixScalar(const char * data, size_t length)
+{
+    size_t i = 0;
+    while (i < length && isPrintableAscii((unsigned char) data[i]))
+        i++;
+    return i;
+}
+
+static size_t asciiPrefixScalar(const char * data, size_t length)
+{
+    size_t i = 0;
+    while (i < length && (unsigned char) data[i] < 0x80)
+        i++;
+    return i;
+}
+
+// Letters of the other case differ by 0x20 only.
+static size_t casePrefixScalar(const char * data, size_t length, bool upper, char * output)
+{
+    const char first = upper ? 'a' : 'A';
+    size_t i = 0;
+    for (; i < length && (unsigned char) data[i] < 0x80; i++)
+    {
+        const char c = data[i];
+        output[i] = (c >= first && c <= first + 25) ? c ^ 0x20 : c;
+    }
+    return i;
+}
+
+#ifdef ASCII_X86
+// As signed bytes, printable characters are above 0x1F and below 0x7F; non-ASCII bytes are negative.
+__attribute__((target("sse2")))
+static size_t printablePrefixSse2(const char * data, size_t length)
+{
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i high = _mm_set1_epi8(0x7F);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, low), _mm_cmplt_epi8(bytes, high));
+        const unsigned mask = _mm_movemask_epi8(printable);
+        if (mask != 0xFFFF)
+            return i + __builtin_ctz(~mask);
+    }
+    return i + printablePrefixScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t printablePrefixAvx2(const char * data, size_t length)
+{
+    const __m256i low = _mm256_set1_epi8(0x1F);
+    const __m256i high = _mm256_set1_epi8(0x7F);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        const __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, low), _mm256_cmpgt_epi8(high, bytes));
+        const unsigned mask = _mm256_movemask_epi8(printable);
+        if (mask != 0xFFFFFFFF)
+            return i + __builtin_ctz(~mask);
+    }
+    return i + printablePrefixSse2(data + i, length - i);
+}
+
+// Non-ASCII bytes have their high bit set.
+__attribute__((target("sse2")))
+static size_t asciiPrefixSse2(const char * data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) (data + i)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + asciiPrefixScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t asciiPrefixAvx2(const char * data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const unsigned mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*) (data + i)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + asciiPrefixSse2(data + i, length - i);
+}
+#endif
+
+static size_t titlePrefixScalar(const char * data, size_t length, bool& inWord, char * output)
+{
+    size_t i = 0;
+    for (; i < length && (unsigned char) data[i] < 0x80; i++)
+    {
+        const char c = data[i];
+        const char lower = (c >= 'A' && c <= 'Z') ? c ^ 0x20 : c;
+        if (lower >= 'a' && lower <= 'z')
+        {
+            output[i] = inWord ? lower : lower ^ 0x20;
+            inWord = true;
+            continue;
+        }
+        output[i] = c;
+        if (c >= '0' && c <= '9')
+            inWord = true;
+        else if (c != '\'')
+            inWord = false;
+    }
+    return i;
+}
+
+// Flips the case of the bytes of 'output' selected by 'mask'.
+static void flipCase(char * output, unsigned mask)
+{
+    while (mask)
+    {
+        output[__builtin_ctz(mask)] ^= 0x20;
+        mask &= mask - 1;
+    }
+}
+
+#ifdef ASCII_X86
+// A block with a non-ASCII byte is left to the narrower version, down to the scalar one.
+__attribute__((target("sse2")))
+static size_t casePrefixSse2(const char * data, size_t length, bool upper, char * output)
+{
+    const __m128i low = _mm_set1_epi8(upper ? 'a' - 1 : 'A' - 1);
+    const __m128i high = _mm_set1_epi8(upper ? 'z' + 1 : 'Z' + 1);
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        if (_mm_movemask_epi8(bytes))
+            break;
+        const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(bytes, low), _mm_cmplt_epi8(bytes, high));
+        _mm_storeu_si128((__m128i*) (output + i), _mm_xor_si128(bytes, _mm_and_si128(letters, flip)));
+    }
+    return i + casePrefixScalar(data + i, length - i, upper, output + i);
+}
+
+__attribute__((target("avx2")))
+static size_t casePrefixAvx2(const char * data, size_t length, bool upper, char * output)
+{
+    const __m256i low = _mm256_set1_epi8(upper ? 'a' - 1 : 'A' - 1);
+    const __m256i high = _mm256_set1_epi8(upper ? 'z' + 1 : 'Z' + 1);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        if (_mm256_movemask_epi8(bytes))
+            break;
+        const __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, low), _mm256_cmpgt_epi8(high, bytes));
+        _mm256_storeu_si256((__m256i*) (output + i), _mm256_xor_si256(bytes, _mm256_and_si256(letters, flip)));
+    }
+    return i + casePrefixSse2(data + i, length - i, upper, output + i);
+}
+
+/*
+ * Blocks are lowered, then word starts are found from masks of letters and
+ * digits shifted by one. A block with an apostrophe is left to the scalar version.
+ */
+__attribute__((target("sse2")))
+static size_t titlePrefixSse2(const char * data, size_t length, bool& inWord, char * output)
+{
+    const __m128i upperLow = _mm_set1_epi8('A' - 1);
+    const __m128i upperHigh = _mm_set1_epi8('Z' + 1);
+    const __m128i lowerLow = _mm_set1_epi8('a' - 1);
+    const __m128i lowerHigh = _mm_set1_epi8('z' + 1);
+    const __m128i digitLow = _mm_set1_epi8('0' - 1);
+    const __m128i digitHigh = _mm_set1_epi8('9' + 1);
+    const __m128i apostrophe = _mm_set1_epi8('\'');
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        if (_mm_movemask_epi8(bytes))
+            break;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, apostrophe)))
+        {
+            titlePrefixScalar(data + i, 16, inWord, output + i);
+            continue;
+        }
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, upperLow), _mm_cmplt_epi8(bytes, upperHigh));
+        const __m128i lower = _mm_xor_si128(bytes, _mm_and_si128(upper, flip));
+        _mm_storeu_si128((__m128i*) (output + i), lower);
+        const unsigned letters = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(lower, lowerLow),
+                                                                 _mm_cmplt_epi8(lower, lowerHigh)));
+        const unsigned digits = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(bytes, digitLow),
+                                                                _mm_cmplt_epi8(bytes, digitHigh)));
+        const unsigned words = letters | digits;
+        flipCase(output + i, letters & ~((words << 1) | inWord) & 0xFFFF);
+        inWord = words >> 15;
+    }
+    return i + titlePrefixScalar(data + i, length - i, inWord, output + i);
+}
+
+__attribute__((target("avx2")))
+static size_t titlePrefixAvx2(const char * data, size_t length, bool& inWord, char * output)
+{
+    const __m256i upperLow = _mm256_set1_epi8('A' - 1);
+    const __m256i upperHigh = _mm256_set1_epi8('Z' + 1);
+    const __m256i lowerLow = _mm256_set1_epi8('a' - 1);
+    const __m256i lowerHigh = _mm256_set1_epi8('z' + 1);
+    const __m256i digitLow = _mm256_set1_epi8('0' - 1);
+    const __m256i digitHigh = _mm256_set1_epi8('9' + 1);
+    const __m256i apostrophe = _mm256_set1_epi8('\'');
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        if (_mm256_movemask_epi8(bytes))
+            break;
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, apostrophe)))
+        {
+            titlePrefixScalar(data + i, 32, inWord, output + i);
+            continue;
+        }
+        const __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, upperLow), _mm256_cmpgt_epi8(upperHigh, bytes));
+        const __m256i lower = _mm256_xor_si256(bytes, _mm256_and_si256(upper, flip));
+        _mm256_storeu_si256((__m256i*) (output + i), lower);
+        const unsigned letters = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpgt_epi8(lower, lowerLow),
+                                                                       _mm256_cmpgt_epi8(lowerHigh, lower)));
+        const unsigned digits = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpgt_epi8(bytes, digitLow),
+                                                                      _mm256_cmpgt_epi8(digitHigh, bytes)));
+        const unsigned words = letters | digits;
+        flipCase(output + i, letters & ~((words << 1) | inWord));
+        inWord = words >> 31;
+    }
+    return i + titlePrefixSse2(data + i, length - i, inWord, output + i);
+}
+#endif
+
+static size_t titlePrefix(const char * data, size_t length, bool& inWord, char * output)
+{
+    if (length < 16)
+        return titlePrefixScalar(data, length, inWord, output);
+#ifdef ASCII_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? titlePrefixAvx2(data, length, inWord, output) : titlePrefixSse2(data, length, inWord, output);
+#else
+    return titlePrefixScalar(data, length, inWord, output);
+#endif
+}
+
+static size_t casePrefix(const char * data, size_t length, bool upper, char * output)
+{
+    if (length < 16)
+        return casePrefixScalar(data, length, upper, output);
+#ifdef ASCII_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? casePrefixAvx2(data, length, upper, output) : casePrefixSse2(data, length, upper, output);
+#else
+    return casePrefixScalar(data, length, upper, output);
+#endif
+}
+
+// Converts through a buffer on the stack, block by block, until a non-ASCII byte.
+template <typename Convert>
+static size_t appendConverted(const char * data, size_t length, string& output, Convert convert)
+{
+    char buffer[ASCII_CASE_BLOCK];
+    size_t done = 0;
+    while (done < length)
+    {
+        const size_t block = min(length - done, sizeof(buffer));
+        const size_t converted = convert(data + done, block, buffer);
+        output.append(buffer, converted);
+        done += converted;
+        if (converted < block)
+            break;
+    }
+    return done;
+}
+
+size_t appendAsciiCase(const char * data, size_t length, bool upper, string& output)
+{
+    return appendConverted(data, length, output, [upper](const char * block, size_t size, char * converted) {
+        return casePrefix(block, size, upper, converted);
+    });
+}
+
+size_t appendAsciiTitle(const char * data, size_t length, bool& inWord, string& output)
+{
+    return appendConverted(data, length, output, [&inWord](const char * block, size_t size, char * converted) {
+        return titlePrefix(block, size, inWord, converted);
+    });
+}
+
+size_t printableAsciiPrefix(const char * data, size_t length)
+{
+    if (length < 16)
+        return printablePrefixScalar(data, length);
+#ifdef ASCII_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? printablePrefixAvx2(data, length) : printablePrefixSse2(data, length);
+#else
+    return printablePrefixScalar(data, length);
+#endif
+}
+
+size_t asciiPrefix(const char * data, size_t length)
+{
+    if (length < 16)
+        return asciiPrefixScalar(data, length);
+#ifdef ASCII_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? asciiPrefixAvx2(data, length) : asciiPrefixSse2(data, length);
+#else
+    return asciiPrefixScalar(data, length);
+#endif
+}
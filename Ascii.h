@@ -0,0 +1,51 @@
+/*
+ * File:   Ascii.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef ASCII_H
+#define ASCII_H
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Length of the leading run of printable ASCII characters (0x20-0x7E).
+ * Vectorized with AVX2 or SSE2 when available.
+ */
+size_t printableAsciiPrefix(const char * data, size_t length);
+
+/*
+ * Length of the leading run of ASCII characters (below 0x80).
+ * Vectorized with AVX2 or SSE2 when available.
+ */
+size_t asciiPrefix(const char * data, size_t length);
+
+/*
+ * Appends the leading run of ASCII characters (below 0x80) in lower or upper
+ * case and returns its length. Vectorized with AVX2 or SSE2 when available.
+ */
+size_t appendAsciiCase(const char * data, size_t length, bool upper, std::string& output);
+
+/*
+ * Same as appendAsciiCase() in lower case, except for the first letter of each
+ * word, in upper case. Letters and digits continue a word and apostrophes leave
+ * 'inWord' as it is; it tells whether the last character ends a word.
+ */
+size_t appendAsciiTitle(const char * data, size_t length, bool& inWord, std::string& output);
+
+inline bool isPrintableAscii(const char * data, size_t length)
+{
+    return printableAsciiPrefix(data, length) == length;
+}
+
+inline bool isPrintableAscii(unsigned char byte)
+{
+    return byte >= 0x20 && byte < 0x7F;
+}
+
+#endif // ASCII_H
@@ -0,0 +1,79 @@
+/*
+ * File:   ByteTables.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef BYTETABLES_H
+#define BYTETABLES_H
+
+/*
+ * Representations of every byte value, built at compile time, in the formats
+ * of valueRepresentation(): 0xA9, \251, 10101001, 169.
+ */
+struct ByteTables
+{
+    char hexadecimal[256][5];
+    char octal[256][5];
+    char binary[256][9];
+    char decimal[256][4];
+};
+
+constexpr ByteTables makeByteTables()
+{
+    ByteTables tables = {};
+    const char digits[] = "0123456789ABCDEF";
+    for (int byte = 0; byte < 256; byte++)
+    {
+        char * hexadecimal = tables.hexadecimal[byte];
+        int i = 0;
+        hexadecimal[i++] = '0';
+        hexadecimal[i++] = 'x';
+        if (byte >= 0x10)
+            hexadecimal[i++] = digits[byte >> 4];
+        hexadecimal[i++] = digits[byte & 0xF];
+        
+        char * octal = tables.octal[byte];
+        octal[0] = '\\';
+        octal[1] = '0' + (byte >> 6);
+        octal[2] = '0' + ((byte >> 3) & 7);
+        octal[3] = '0' + (byte & 7);
+        
+        for (int bit = 0; bit < 8; bit++)
+            tables.binary[byte][bit] = (byte & (0x80 >> bit)) ? '1' : '0';
+        
+        char * decimal = tables.decimal[byte];
+        i = 0;
+        if (byte >= 100)
+            decimal[i++] = '0' + byte / 100;
+        if (byte >= 10)
+            decimal[i++] = '0' + (byte / 10) % 10;
+        decimal[i++] = '0' + byte % 10;
+    }
+    return tables;
+}
+
+inline constexpr ByteTables byteTables = makeByteTables();
+
+// A byte in base 2, 8, 10 or 16; NULL for other bases.
+inline const char * byteRepresentation(unsigned char byte, int base)
+{
+    switch (base)
+    {
+        case 2:
+            return byteTables.binary[byte];
+        case 8:
+            return byteTables.octal[byte];
+        case 10:
+            return byteTables.decimal[byte];
+        case 16:
+            return byteTables.hexadecimal[byte];
+        default:
+            return NULL;
+    }
+}
+
+#endif // BYTETABLES_H
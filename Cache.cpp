@@ -0,0 +1,174 @@
+/*
+ * File:   Cache.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Cache.h"
+#include <cstring>
+#include <atomic>
+
+using namespace std;
+
+ResultCache::ResultCache(size_t capacity)
+{
+    const size_t entries = max((size_t) 1, capacity / (sizeof(Entry) + 2 * sizeof(uint32_t)));
+    size_t slots = 2;
+    while (slots < 2 * entries)
+        slots <<= 1;
+    m_entries.resize(entries);
+    m_index.assign(slots, EMPTY);
+    m_mask = slots - 1;
+}
+
+uint64_t ResultCache::hash(int tag, string_view input)
+{
+    uint64_t h = ((uint64_t) tag << 32 | input.size()) * 0x9E3779B97F4A7C15ULL;
+    const char * data = input.data();
+    size_t length = input.size();
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        data += 8;
+        length -= 8;
+    }
+    if (length)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data, length);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+    }
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 33);
+}
+
+bool ResultCache::find(int tag, string_view input, string& output)
+{
+    if (input.size() > CACHE_ENTRY_SIZE)
+    {
+        m_stats.misses++;
+        return false;
+    }
+    const uint64_t h = hash(tag, input);
+    for (size_t slot = h & m_mask; m_index[slot] != EMPTY; slot = (slot + 1) & m_mask)
+    {
+        Entry& entry = m_entries[m_index[slot]];
+        if (entry.hash == h && entry.tag == tag && entry.inputLength == input.size()
+            && memcmp(entry.bytes, input.data(), input.size()) == 0)
+        {
+            entry.referenced = true;
+            output.append(entry.bytes + entry.inputLength, entry.resultLength);
+            m_stats.hits++;
+            return true;
+        }
+    }
+    m_stats.misses++;
+    return false;
+}
+
+void ResultCache::insert(int tag, string_view input, string_view result)
+{
+    if (input.size() + result.size() > CACHE_ENTRY_SIZE)
+        return;
+    uint32_t id;
+    if (m_used < m_entries.size())
+    {
+        id = m_used++;
+    }
+    else
+    {
+        // Entries hit since the last pass get a second chance.
+        while (m_entries[m_hand].referenced)
+        {
+            m_entries[m_hand].referenced = false;
+            m_hand = (m_hand + 1) % m_entries.size();
+        }
+        id = m_hand;
+        m_hand = (m_hand + 1) % m_entries.size();
+        unlink(id);
+        m_stats.evictions++;
+    }
+    Entry& entry = m_entries[id];
+    entry.hash = hash(tag, input);
+    entry.tag = tag;
+    entry.inputLength = input.size();
+    entry.resultLength = result.size();
+    entry.referenced = false;
+    memcpy(entry.bytes, input.data(), input.size());
+    memcpy(entry.bytes + input.size(), result.data(), result.size());
+    size_t slot = entry.hash & m_mask;
+    while (m_index[slot] != EMPTY)
+        slot = (slot + 1) & m_mask;
+    m_index[slot] = id;
+}
+
+void ResultCache::unlink(uint32_t entry)
+{
+    size_t hole = m_entries[entry].hash & m_mask;
+    while (m_index[hole] != entry)
+        hole = (hole + 1) & m_mask;
+    m_index[hole] = EMPTY;
+    for (size_t slot = (hole + 1) & m_mask; m_index[slot] != EMPTY; slot = (slot + 1) & m_mask)
+    {
+        // An entry stays if its home slot lies cyclically in (hole, slot].
+        const size_t home = m_entries[m_index[slot]].hash & m_mask;
+        const bool stays = (hole <= slot) ? (hole < home && home <= slot) : (hole < home || home <= slot);
+        if (stays)
+            continue;
+        m_index[hole] = m_index[slot];
+        m_index[slot] = EMPTY;
+        hole = slot;
+    }
+}
+
+ResultCaches::ResultCaches(size_t capacity)
+    : m_capacity(capacity)
+{
+    static atomic<uint64_t> instances(0);
+    m_id = ++instances;
+}
+
+ResultCache& ResultCaches::local()
+{
+    // The same instance is used for a whole stream.
+    thread_local uint64_t lastId = 0;
+    thread_local ResultCache * last = NULL;
+    if (lastId == m_id)
+        return *last;
+    const thread::id self = this_thread::get_id();
+    lock_guard<mutex> lock(m_mutex);
+    ResultCache * cache = NULL;
+    for (const pair<thread::id, unique_ptr<ResultCache>>& entry : m_caches)
+    {
+        if (entry.first == self)
+            cache = entry.second.get();
+    }
+    if (!cache)
+    {
+        m_caches.emplace_back(self, make_unique<ResultCache>(m_capacity));
+        cache = m_caches.back().second.get();
+    }
+    lastId = m_id;
+    last = cache;
+    return *cache;
+}
+
+CacheStats ResultCaches::stats() const
+{
+    CacheStats sum;
+    lock_guard<mutex> lock(m_mutex);
+    for (const pair<thread::id, unique_ptr<ResultCache>>& entry : m_caches)
+    {
+        sum.hits += entry.second->stats().hits;
+        sum.misses += entry.second->stats().misses;
+        sum.evictions += entry.second->stats().evictions;
+    }
+    return sum;
+}
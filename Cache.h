@@ -0,0 +1,94 @@
+/*
+ * File:   Cache.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+// Bytes of an input and of its result kept inline in a cache entry; longer pairs are not cached.
+#define CACHE_ENTRY_SIZE 112
+
+struct CacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+/*
+ * A bounded memo of results, keyed by the bytes of an input and by a tag
+ * standing for the options that produced them.
+ * Entries are fixed-size records allocated at construction; an open-addressing
+ * index with linear probing finds them. Once full, the CLOCK algorithm evicts
+ * an entry that was not hit since the hand last passed it.
+ * Not safe to use concurrently.
+ */
+class ResultCache
+{
+public:
+    // 'capacity' is in bytes, the index included.
+    explicit ResultCache(size_t capacity);
+    // Appends the cached result of 'input' to 'output'; false on a miss.
+    bool find(int tag, std::string_view input, std::string& output);
+    // Adds a result that find() missed.
+    void insert(int tag, std::string_view input, std::string_view result);
+    const CacheStats& stats() const { return m_stats; }
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        int tag;
+        uint8_t inputLength;
+        uint8_t resultLength;
+        bool referenced;
+        // The input followed by its result.
+        char bytes[CACHE_ENTRY_SIZE];
+    };
+    static const uint32_t EMPTY = UINT32_MAX;
+    std::vector<Entry> m_entries;
+    // Indices into 'm_entries'; a power of two, twice as many as the entries.
+    std::vector<uint32_t> m_index;
+    size_t m_mask;
+    size_t m_used = 0;
+    size_t m_hand = 0;
+    CacheStats m_stats;
+
+    static uint64_t hash(int tag, std::string_view input);
+    // Removes an entry from the index, shifting back the entries that probed past it.
+    void unlink(uint32_t entry);
+};
+
+/*
+ * A ResultCache per thread calling local(), each with the same capacity.
+ */
+class ResultCaches
+{
+public:
+    explicit ResultCaches(size_t capacity);
+    ResultCache& local();
+    // The sum over the threads.
+    CacheStats stats() const;
+
+private:
+    size_t m_capacity;
+    // Distinguishes the instances in the per-thread lookup of local().
+    uint64_t m_id;
+    mutable std::mutex m_mutex;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<ResultCache>>> m_caches;
+};
+
+#endif // CACHE_H
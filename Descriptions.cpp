@@ -0,0 +1,188 @@
+/*
+ * File:   Descriptions.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Descriptions.h"
+#include <atomic>
+#include <initializer_list>
+#include <libintl.h>
+#include <utf8proc.h>
+
+using namespace std;
+
+// Marks a string for xgettext; it is translated when it is looked up.
+#define N_(STRING) STRING
+
+struct Description
+{
+    int value;
+    const char * text;
+};
+
+/*
+ * Untranslated descriptions indexed by the values of a utf8proc enumeration,
+ * filled at compile time. Values without description are null.
+ */
+template <size_t N>
+struct DescriptionTable
+{
+    const char * texts[N] = {};
+    
+    constexpr DescriptionTable(initializer_list<Description> descriptions)
+    {
+        for (const Description& description : descriptions)
+            texts[description.value] = description.text;
+    }
+};
+
+// Described in utf8proc.h.
+// Translatable, but we won't do it on our own.
+constexpr DescriptionTable<UTF8PROC_CATEGORY_CO + 1> categoryTexts = {
+    {UTF8PROC_CATEGORY_CN, N_("Other, not assigned")},
+    {UTF8PROC_CATEGORY_LU, N_("Letter, uppercase")},
+    {UTF8PROC_CATEGORY_LL, N_("Letter, lowercase")},
+    {UTF8PROC_CATEGORY_LT, N_("Letter, titlecase")},
+    {UTF8PROC_CATEGORY_LM, N_("Letter, modifier")},
+    {UTF8PROC_CATEGORY_LO, N_("Letter, other")},
+    {UTF8PROC_CATEGORY_MN, N_("Mark, nonspacing")},
+    {UTF8PROC_CATEGORY_MC, N_("Mark, spacing combining")},
+    {UTF8PROC_CATEGORY_ME, N_("Mark, enclosing")},
+    {UTF8PROC_CATEGORY_ND, N_("Number, decimal digit")},
+    {UTF8PROC_CATEGORY_NL, N_("Number, letter")},
+    {UTF8PROC_CATEGORY_NO, N_("Number, other")},
+    {UTF8PROC_CATEGORY_PC, N_("Punctuation, connector")},
+    {UTF8PROC_CATEGORY_PD, N_("Punctuation, dash")},
+    {UTF8PROC_CATEGORY_PS, N_("Punctuation, open")},
+    {UTF8PROC_CATEGORY_PE, N_("Punctuation, close")},
+    {UTF8PROC_CATEGORY_PI, N_("Punctuation, initial quote")},
+    {UTF8PROC_CATEGORY_PF, N_("Punctuation, final quote")},
+    {UTF8PROC_CATEGORY_PO, N_("Punctuation, other")},
+    {UTF8PROC_CATEGORY_SM, N_("Symbol, math")},
+    {UTF8PROC_CATEGORY_SC, N_("Symbol, currency")},
+    {UTF8PROC_CATEGORY_SK, N_("Symbol, modifier")},
+    {UTF8PROC_CATEGORY_SO, N_("Symbol, other")},
+    {UTF8PROC_CATEGORY_ZS, N_("Separator, space")},
+    {UTF8PROC_CATEGORY_ZL, N_("Separator, line")},
+    {UTF8PROC_CATEGORY_ZP, N_("Separator, paragraph")},
+    {UTF8PROC_CATEGORY_CC, N_("Other, control")},
+    {UTF8PROC_CATEGORY_CF, N_("Other, format")},
+    {UTF8PROC_CATEGORY_CS, N_("Other, surrogate")},
+    {UTF8PROC_CATEGORY_CO, N_("Other, private use")},
+};
+
+constexpr DescriptionTable<UTF8PROC_BIDI_CLASS_PDI + 1> bidirectionalTexts = {
+    {UTF8PROC_BIDI_CLASS_L, N_("Left-to-Right")},
+    {UTF8PROC_BIDI_CLASS_LRE, N_("Left-to-Right Embedding")},
+    {UTF8PROC_BIDI_CLASS_LRO, N_("Left-to-Right Override")},
+    {UTF8PROC_BIDI_CLASS_R, N_("Right-to-Left")},
+    {UTF8PROC_BIDI_CLASS_AL, N_("Right-to-Left Arabic")},
+    {UTF8PROC_BIDI_CLASS_RLE, N_("Right-to-Left Embedding")},
+    {UTF8PROC_BIDI_CLASS_RLO, N_("Right-to-Left Override")},
+    {UTF8PROC_BIDI_CLASS_PDF, N_("Pop Directional Format")},
+    {UTF8PROC_BIDI_CLASS_EN, N_("European Number")},
+    {UTF8PROC_BIDI_CLASS_ES, N_("European Separator")},
+    {UTF8PROC_BIDI_CLASS_ET, N_("European Number Terminator")},
+    {UTF8PROC_BIDI_CLASS_AN, N_("Arabic Number")},
+    {UTF8PROC_BIDI_CLASS_CS, N_("Common Number Separator")},
+    {UTF8PROC_BIDI_CLASS_NSM, N_("Nonspacing Mark")},
+    {UTF8PROC_BIDI_CLASS_BN, N_("Boundary Neutral")},
+    {UTF8PROC_BIDI_CLASS_B, N_("Paragraph Separator")},
+    {UTF8PROC_BIDI_CLASS_S, N_("Segment Separator")},
+    {UTF8PROC_BIDI_CLASS_WS, N_("Whitespace")},
+    {UTF8PROC_BIDI_CLASS_ON, N_("Other Neutrals")},
+    {UTF8PROC_BIDI_CLASS_LRI, N_("Left-to-Right Isolate")},
+    {UTF8PROC_BIDI_CLASS_RLI, N_("Right-to-Left Isolate")},
+    {UTF8PROC_BIDI_CLASS_FSI, N_("First Strong Isolate")},
+    {UTF8PROC_BIDI_CLASS_PDI, N_("Pop Directional Isolate")},
+};
+
+// Whatever it means! But does it concern decomposed form only?
+constexpr DescriptionTable<UTF8PROC_DECOMP_TYPE_COMPAT + 1> decompositionTypeTexts = {
+    {0, N_("Unknown")}, // property->decomp_type is 0 on all tested characters, decomposed or not.
+    {UTF8PROC_DECOMP_TYPE_FONT, N_("Font")}, // Starts at 1.
+    {UTF8PROC_DECOMP_TYPE_NOBREAK, N_("Nobreak")},
+    {UTF8PROC_DECOMP_TYPE_INITIAL, N_("Initial")},
+    {UTF8PROC_DECOMP_TYPE_MEDIAL, N_("Medial")},
+    {UTF8PROC_DECOMP_TYPE_FINAL, N_("Final")},
+    {UTF8PROC_DECOMP_TYPE_ISOLATED, N_("Isolated")},
+    {UTF8PROC_DECOMP_TYPE_CIRCLE, N_("Circle")},
+    {UTF8PROC_DECOMP_TYPE_SUPER, N_("Super")},
+    {UTF8PROC_DECOMP_TYPE_SUB, N_("Sub")},
+    {UTF8PROC_DECOMP_TYPE_VERTICAL, N_("Vertical")},
+    {UTF8PROC_DECOMP_TYPE_WIDE, N_("Wide")},
+    {UTF8PROC_DECOMP_TYPE_NARROW, N_("Narrow")},
+    {UTF8PROC_DECOMP_TYPE_SMALL, N_("Small")},
+    {UTF8PROC_DECOMP_TYPE_SQUARE, N_("Square")},
+    {UTF8PROC_DECOMP_TYPE_FRACTION, N_("Fraction")},
+    {UTF8PROC_DECOMP_TYPE_COMPAT, N_("Compat")},
+};
+
+// Whatever most values mean!
+constexpr DescriptionTable<UTF8PROC_BOUNDCLASS_E_ZWG + 1> boundClassTexts = {
+    {UTF8PROC_BOUNDCLASS_START, N_("Start")},
+    {UTF8PROC_BOUNDCLASS_OTHER, N_("Other")},
+    {UTF8PROC_BOUNDCLASS_CR, N_("Cr")},
+    {UTF8PROC_BOUNDCLASS_LF, N_("Lf")},
+    {UTF8PROC_BOUNDCLASS_CONTROL, N_("Control")},
+    {UTF8PROC_BOUNDCLASS_EXTEND, N_("Extend")},
+    {UTF8PROC_BOUNDCLASS_L, N_("L")},
+    {UTF8PROC_BOUNDCLASS_V, N_("V")},
+    {UTF8PROC_BOUNDCLASS_T, N_("T")},
+    {UTF8PROC_BOUNDCLASS_LV, N_("Lv")},
+    {UTF8PROC_BOUNDCLASS_LVT, N_("Lvt")},
+    {UTF8PROC_BOUNDCLASS_REGIONAL_INDICATOR, N_("Regional indicator")},
+    {UTF8PROC_BOUNDCLASS_SPACINGMARK, N_("Spacingmark")},
+    {UTF8PROC_BOUNDCLASS_PREPEND, N_("Prepend")},
+    {UTF8PROC_BOUNDCLASS_ZWJ, N_("Zero Width Joiner")},
+    {UTF8PROC_BOUNDCLASS_E_BASE, N_("Emoji Base")},
+    {UTF8PROC_BOUNDCLASS_E_MODIFIER, N_("Emoji Modifier")},
+    {UTF8PROC_BOUNDCLASS_GLUE_AFTER_ZWJ, N_("Glue_After_ZWJ")},
+    {UTF8PROC_BOUNDCLASS_E_BASE_GAZ, N_("E_BASE + GLUE_AFTER_ZJW")},
+    {UTF8PROC_BOUNDCLASS_EXTENDED_PICTOGRAPHIC, N_("Extended_Pictographic")},
+    {UTF8PROC_BOUNDCLASS_E_ZWG, N_("UTF8PROC_BOUNDCLASS_EXTENDED_PICTOGRAPHIC + ZWJ")},
+};
+
+// Translations are looked up once, on first use.
+static atomic<const char *> categoryTranslations[UTF8PROC_CATEGORY_CO + 1];
+static atomic<const char *> bidirectionalTranslations[UTF8PROC_BIDI_CLASS_PDI + 1];
+static atomic<const char *> decompositionTypeTranslations[UTF8PROC_DECOMP_TYPE_COMPAT + 1];
+static atomic<const char *> boundClassTranslations[UTF8PROC_BOUNDCLASS_E_ZWG + 1];
+
+template <size_t N>
+static const char * translate(const DescriptionTable<N>& table, atomic<const char *> (&translations)[N], int value)
+{
+    if (value < 0 || size_t(value) >= N || table.texts[value] == NULL)
+        return "";
+    const char * translated = translations[value].load(memory_order_relaxed);
+    if (translated == NULL)
+    {
+        translated = gettext(table.texts[value]);
+        translations[value].store(translated, memory_order_relaxed);
+    }
+    return translated;
+}
+
+const char * categoryDescription(int category)
+{
+    return translate(categoryTexts, categoryTranslations, category);
+}
+
+const char * bidirectionalDescription(int bidiClass)
+{
+    return translate(bidirectionalTexts, bidirectionalTranslations, bidiClass);
+}
+
+const char * decompositionTypeDescription(int decompositionType)
+{
+    return translate(decompositionTypeTexts, decompositionTypeTranslations, decompositionType);
+}
+
+const char * boundClassDescription(int boundClass)
+{
+    return translate(boundClassTexts, boundClassTranslations, boundClass);
+}
@@ -0,0 +1,22 @@
+/*
+ * File:   Descriptions.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef DESCRIPTIONS_H
+#define DESCRIPTIONS_H
+
+/*
+ * Translated descriptions of the values of utf8proc properties, empty for
+ * values without description. Nothing is translated before it is asked for.
+ */
+const char * categoryDescription(int category);
+const char * bidirectionalDescription(int bidiClass);
+const char * decompositionTypeDescription(int decompositionType);
+const char * boundClassDescription(int boundClass);
+
+#endif // DESCRIPTIONS_H
@@ -0,0 +1,457 @@
+/*
+ * File:   Encoding.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Encoding.h"
+#include <cstring>
+#include "Utf8.h"
+#include "Ascii.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENCODING_X86
+#endif
+
+using namespace std;
+
+bool encodingName(string_view name, TextEncoding& encoding)
+{
+    string key;
+    for (char c : name)
+    {
+        if (c != '-' && c != '_')
+            key.push_back(c >= 'a' && c <= 'z' ? c ^ 0x20 : c);
+    }
+    static const struct
+    {
+        const char * name;
+        Encoding encoding;
+        bool byteOrderMark;
+    } names[] = {
+        {"UTF8", ENCODING_UTF8, false},
+        {"UTF16", ENCODING_UTF16BE, true},
+        {"UTF16LE", ENCODING_UTF16LE, false},
+        {"UTF16BE", ENCODING_UTF16BE, false},
+        {"UTF32", ENCODING_UTF32BE, true},
+        {"UTF32LE", ENCODING_UTF32LE, false},
+        {"UTF32BE", ENCODING_UTF32BE, false},
+        {"LATIN1", ENCODING_LATIN1, false},
+        {"ISO88591", ENCODING_LATIN1, false}};
+    for (const auto& entry : names)
+    {
+        if (key == entry.name)
+        {
+            encoding.encoding = entry.encoding;
+            encoding.byteOrderMark = entry.byteOrderMark;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char * encodingLabel(Encoding encoding)
+{
+    static const char * const labels[] = {"UTF-8", "UTF-16LE", "UTF-16BE", "UTF-32LE", "UTF-32BE", "Latin-1"};
+    return labels[encoding];
+}
+
+static bool bigEndian(Encoding encoding)
+{
+    return encoding == ENCODING_UTF16BE || encoding == ENCODING_UTF32BE;
+}
+
+static int unitSize(Encoding encoding)
+{
+    switch (encoding)
+    {
+        case ENCODING_UTF16LE:
+        case ENCODING_UTF16BE:
+            return 2;
+        case ENCODING_UTF32LE:
+        case ENCODING_UTF32BE:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+static uint32_t readUnit(const char * data, int size, bool big)
+{
+    const unsigned char * bytes = (const unsigned char*) data;
+    if (size == 2)
+        return big ? (bytes[0] << 8 | bytes[1]) : (bytes[1] << 8 | bytes[0]);
+    return big ? ((uint32_t) bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3])
+               : ((uint32_t) bytes[3] << 24 | bytes[2] << 16 | bytes[1] << 8 | bytes[0]);
+}
+
+static void writeUnit(uint32_t unit, int size, bool big, char * output)
+{
+    for (int i = 0; i < size; i++)
+    {
+        const int shift = 8 * (big ? size - 1 - i : i);
+        output[i] = (char) (unit >> shift);
+    }
+}
+
+// The codepoint of the sequence at 'data', U+FFFD if it is ill-formed; 'size' receives its length.
+static utf8proc_int32_t codepointAt(const char * data, size_t length, int& size)
+{
+    size = utf8SequenceLength(data, length);
+    if (size < 0)
+    {
+        size = -size;
+        return 0xFFFD;
+    }
+    const unsigned char * bytes = (const unsigned char*) data;
+    switch (size)
+    {
+        case 1:
+            return bytes[0];
+        case 2:
+            return (bytes[0] & 0x1F) << 6 | (bytes[1] & 0x3F);
+        case 3:
+            return (bytes[0] & 0x0F) << 12 | (bytes[1] & 0x3F) << 6 | (bytes[2] & 0x3F);
+        default:
+            return (bytes[0] & 0x07) << 18 | (bytes[1] & 0x3F) << 12 | (bytes[2] & 0x3F) << 6 | (bytes[3] & 0x3F);
+    }
+}
+
+static size_t widenScalar(const char * data, size_t length, int size, bool big, char * output)
+{
+    size_t i = 0;
+    for (; i < length && (unsigned char) data[i] < 0x80; i++)
+        writeUnit((unsigned char) data[i], size, big, output + i * size);
+    return i;
+}
+
+static size_t narrowScalar(const char * data, size_t units, int size, bool big, char * output)
+{
+    size_t i = 0;
+    for (; i < units; i++)
+    {
+        const uint32_t unit = readUnit(data + i * size, size, big);
+        if (unit >= 0x80)
+            break;
+        output[i] = (char) unit;
+    }
+    return i;
+}
+
+#ifdef ENCODING_X86
+// Interleaving with zero bytes makes code units of twice the size, the zeros first in big-endian.
+__attribute__((target("sse2")))
+static size_t widenSse2(const char * data, size_t length, int size, bool big, char * output)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        if (_mm_movemask_epi8(bytes))
+            break;
+        const __m128i low = big ? _mm_unpacklo_epi8(zero, bytes) : _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = big ? _mm_unpackhi_epi8(zero, bytes) : _mm_unpackhi_epi8(bytes, zero);
+        __m128i * out = (__m128i*) (output + i * size);
+        if (size == 2)
+        {
+            _mm_storeu_si128(out, low);
+            _mm_storeu_si128(out + 1, high);
+            continue;
+        }
+        if (big)
+        {
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(zero, low));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(zero, low));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(zero, high));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(zero, high));
+        }
+        else
+        {
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+        }
+    }
+    return i + widenScalar(data + i, length - i, size, big, output + i * size);
+}
+
+/*
+ * Sixteen code units at a time. Read in little-endian, an ASCII character of a
+ * big-endian unit is in its most significant byte, and is shifted down.
+ */
+__attribute__((target("sse2")))
+static size_t narrowSse2(const char * data, size_t units, int size, bool big, char * output)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= units; i += 16)
+    {
+        const __m128i * in = (const __m128i*) (data + i * size);
+        __m128i packed;
+        if (size == 2)
+        {
+            const __m128i nonAscii = _mm_set1_epi16(big ? 0x80FF : (short) 0xFF80);
+            __m128i a = _mm_loadu_si128(in);
+            __m128i b = _mm_loadu_si128(in + 1);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(_mm_or_si128(a, b), nonAscii), zero)) != 0xFFFF)
+                break;
+            if (big)
+            {
+                a = _mm_srli_epi16(a, 8);
+                b = _mm_srli_epi16(b, 8);
+            }
+            packed = _mm_packus_epi16(a, b);
+        }
+        else
+        {
+            const __m128i nonAscii = _mm_set1_epi32(big ? 0x80FFFFFF : (int) 0xFFFFFF80);
+            __m128i a = _mm_loadu_si128(in);
+            __m128i b = _mm_loadu_si128(in + 1);
+            __m128i c = _mm_loadu_si128(in + 2);
+            __m128i d = _mm_loadu_si128(in + 3);
+            const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(all, nonAscii), zero)) != 0xFFFF)
+                break;
+            if (big)
+            {
+                a = _mm_srli_epi32(a, 24);
+                b = _mm_srli_epi32(b, 24);
+                c = _mm_srli_epi32(c, 24);
+                d = _mm_srli_epi32(d, 24);
+            }
+            packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        }
+        _mm_storeu_si128((__m128i*) (output + i), packed);
+    }
+    return i + narrowScalar(data + i * size, units - i, size, big, output + i);
+}
+#endif
+
+// Converts the leading ASCII characters of 'data' to code units of 'size' bytes, and returns how many.
+static size_t widenAscii(const char * data, size_t length, int size, bool big, char * output)
+{
+#ifdef ENCODING_X86
+    return widenSse2(data, length, size, big, output);
+#else
+    return widenScalar(data, length, size, big, output);
+#endif
+}
+
+// Converts the leading code units of 'data' below 0x80 to bytes, and returns how many.
+static size_t narrowAscii(const char * data, size_t units, int size, bool big, char * output)
+{
+#ifdef ENCODING_X86
+    return narrowSse2(data, units, size, big, output);
+#else
+    return narrowScalar(data, units, size, big, output);
+#endif
+}
+
+TextDecoder::TextDecoder(const TextEncoding& encoding, bool drop)
+    : m_encoding(encoding.encoding), m_detect(encoding.byteOrderMark), m_drop(drop)
+{
+}
+
+size_t TextDecoder::decode(const char * data, size_t length, bool last, char * output, size_t& written,
+                           vector<u7::InvalidSequence>& invalid)
+{
+    written = 0;
+    size_t pos = 0;
+    if (!m_started)
+    {
+        const int size = unitSize(m_encoding);
+        const size_t markLength = (m_encoding == ENCODING_UTF8) ? 3 : (m_encoding == ENCODING_LATIN1) ? 0 : size;
+        if (length < markLength && !last)
+            return 0;
+        m_started = true;
+        if (markLength && length >= markLength)
+        {
+            char utf8Mark[] = "\xEF\xBB\xBF";
+            char mark[4];
+            writeUnit(0xFEFF, size, bigEndian(m_encoding), mark);
+            char swapped[4];
+            writeUnit(0xFEFF, size, !bigEndian(m_encoding), swapped);
+            if (memcmp(data, m_encoding == ENCODING_UTF8 ? utf8Mark : mark, markLength) == 0)
+            {
+                pos = markLength;
+            }
+            else if (m_detect && m_encoding != ENCODING_UTF8 && memcmp(data, swapped, markLength) == 0)
+            {
+                pos = markLength;
+                m_encoding = Encoding(bigEndian(m_encoding) ? m_encoding - 1 : m_encoding + 1);
+            }
+        }
+    }
+    const int size = unitSize(m_encoding);
+    const bool big = bigEndian(m_encoding);
+    auto reject = [&](size_t at, size_t count) {
+        invalid.push_back({(size_t) m_offset + at, count});
+        if (!m_drop)
+        {
+            memcpy(output + written, "\xEF\xBF\xBD", 3);
+            written += 3;
+        }
+    };
+    if (m_encoding == ENCODING_UTF8)
+    {
+        while (pos < length)
+        {
+            const size_t valid = validUtf8Prefix(data + pos, length - pos);
+            memcpy(output + written, data + pos, valid);
+            written += valid;
+            pos += valid;
+            if (pos == length)
+                break;
+            const size_t subpart = -utf8SequenceLength(data + pos, length - pos);
+            // The sequence may be completed by what follows.
+            if (!last && pos + subpart == length)
+                break;
+            reject(pos, subpart);
+            pos += subpart;
+        }
+    }
+    else if (m_encoding == ENCODING_LATIN1)
+    {
+        while (pos < length)
+        {
+            const size_t ascii = asciiPrefix(data + pos, length - pos);
+            memcpy(output + written, data + pos, ascii);
+            written += ascii;
+            pos += ascii;
+            if (pos == length)
+                break;
+            const unsigned char byte = data[pos++];
+            output[written++] = (char) (0xC0 | byte >> 6);
+            output[written++] = (char) (0x80 | (byte & 0x3F));
+        }
+    }
+    else
+    {
+        while (pos + size <= length)
+        {
+            uint32_t codepoint = readUnit(data + pos, size, big);
+            if (codepoint < 0x80)
+            {
+                const size_t ascii = narrowAscii(data + pos, (length - pos) / size, size, big, output + written);
+                written += ascii;
+                pos += ascii * size;
+                continue;
+            }
+            size_t consumed = size;
+            bool valid = true;
+            if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+            {
+                valid = false;
+                if (size == 2 && codepoint <= 0xDBFF)
+                {
+                    if (pos + 4 > length && !last)
+                        break; // The low surrogate may follow.
+                    const uint32_t low = pos + 4 <= length ? readUnit(data + pos + 2, 2, big) : 0;
+                    if (low >= 0xDC00 && low <= 0xDFFF)
+                    {
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                        consumed = 4;
+                        valid = true;
+                    }
+                }
+            }
+            else if (codepoint > 0x10FFFF)
+            {
+                valid = false;
+            }
+            if (valid)
+                written += utf8proc_encode_char(codepoint, (utf8proc_uint8_t*) output + written);
+            else
+                reject(pos, size);
+            pos += consumed;
+        }
+        // A truncated code unit.
+        if (last && pos < length)
+        {
+            reject(pos, length - pos);
+            pos = length;
+        }
+    }
+    m_offset += pos;
+    return pos;
+}
+
+TextEncoder::TextEncoder(const TextEncoding& encoding)
+    : m_encoding(encoding.encoding), m_byteOrderMark(encoding.byteOrderMark)
+{
+}
+
+void TextEncoder::encode(string_view data, string& output)
+{
+    const int size = unitSize(m_encoding);
+    const bool big = bigEndian(m_encoding);
+    if (m_byteOrderMark)
+    {
+        m_byteOrderMark = false;
+        if (m_encoding == ENCODING_UTF8)
+        {
+            output += "\xEF\xBB\xBF";
+        }
+        else if (m_encoding != ENCODING_LATIN1)
+        {
+            char mark[4];
+            writeUnit(0xFEFF, size, big, mark);
+            output.append(mark, size);
+        }
+    }
+    if (m_encoding == ENCODING_UTF8)
+    {
+        output += data;
+        return;
+    }
+    // A unit per byte of UTF-8 at most, or a surrogate pair for four bytes.
+    const size_t start = output.size();
+    output.resize(start + data.size() * size);
+    char * out = output.data() + start;
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        if ((unsigned char) data[pos] < 0x80)
+        {
+            size_t ascii;
+            if (m_encoding == ENCODING_LATIN1)
+            {
+                ascii = asciiPrefix(data.data() + pos, data.size() - pos);
+                memcpy(out, data.data() + pos, ascii);
+            }
+            else
+            {
+                ascii = widenAscii(data.data() + pos, data.size() - pos, size, big, out);
+            }
+            out += ascii * size;
+            pos += ascii;
+            continue;
+        }
+        int length;
+        const utf8proc_int32_t codepoint = codepointAt(data.data() + pos, data.size() - pos, length);
+        pos += length;
+        if (m_encoding == ENCODING_LATIN1)
+        {
+            if (codepoint > 0xFF)
+                m_unrepresentable++;
+            *out++ = codepoint > 0xFF ? '?' : (char) codepoint;
+        }
+        else if (size == 2 && codepoint >= 0x10000)
+        {
+            writeUnit(0xD800 + ((codepoint - 0x10000) >> 10), 2, big, out);
+            writeUnit(0xDC00 + ((codepoint - 0x10000) & 0x3FF), 2, big, out + 2);
+            out += 4;
+        }
+        else
+        {
+            writeUnit(codepoint, size, big, out);
+            out += size;
+        }
+    }
+    output.resize(out - output.data());
+}
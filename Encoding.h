@@ -0,0 +1,91 @@
+/*
+ * File:   Encoding.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "U7.h"
+
+enum Encoding {ENCODING_UTF8, ENCODING_UTF16LE, ENCODING_UTF16BE, ENCODING_UTF32LE, ENCODING_UTF32BE, ENCODING_LATIN1};
+
+struct TextEncoding
+{
+    Encoding encoding = ENCODING_UTF8;
+    /*
+     * On input, a byte order mark tells the byte order of UTF-16 and UTF-32,
+     * big-endian without one; on output, one is written first.
+     */
+    bool byteOrderMark = false;
+};
+
+/*
+ * UTF-8, UTF-16, UTF-16LE, UTF-16BE, UTF-32, UTF-32LE, UTF-32BE or Latin-1,
+ * also ISO-8859-1, in any case and with or without the hyphens; false for any
+ * other name. UTF-16 and UTF-32 are big-endian with a byte order mark.
+ */
+bool encodingName(std::string_view name, TextEncoding& encoding);
+
+// Such as UTF-16LE.
+const char * encodingLabel(Encoding encoding);
+
+/*
+ * Decodes text to UTF-8, piecewise; a byte order mark at the start is skipped.
+ * Ill-formed input, including unpaired surrogates and truncated code units, is
+ * replaced with U+FFFD or dropped.
+ * Runs of ASCII characters are converted with SSE2 when available.
+ */
+class TextDecoder
+{
+public:
+    TextDecoder(const TextEncoding& encoding, bool drop);
+    // Bytes of UTF-8 written per byte of input, at most.
+    static const size_t EXPANSION = 3;
+    /*
+     * Decodes the complete sequences of 'data' to 'output', which must hold
+     * EXPANSION times 'length' bytes, and returns the length consumed; the
+     * rest must be passed again, followed by more input, or with 'last' set
+     * for everything to be consumed. 'written' receives the length written.
+     * Ill-formed sequences are appended to 'invalid', at their offsets in the
+     * whole input.
+     */
+    size_t decode(const char * data, size_t length, bool last, char * output, size_t& written,
+                  std::vector<u7::InvalidSequence>& invalid);
+
+private:
+    Encoding m_encoding;
+    bool m_detect;
+    bool m_drop;
+    bool m_started = false;
+    uint64_t m_offset = 0;
+};
+
+/*
+ * Encodes valid UTF-8. Characters beyond Latin-1 are replaced with '?' there.
+ * Runs of ASCII characters are converted with SSE2 when available.
+ */
+class TextEncoder
+{
+public:
+    explicit TextEncoder(const TextEncoding& encoding);
+    // Appends the encoding of 'data' to 'output', after a byte order mark on the first call if asked.
+    void encode(std::string_view data, std::string& output);
+    // Characters replaced with '?' so far.
+    uint64_t unrepresentable() const { return m_unrepresentable; }
+
+private:
+    Encoding m_encoding;
+    bool m_byteOrderMark;
+    uint64_t m_unrepresentable = 0;
+};
+
+#endif // ENCODING_H
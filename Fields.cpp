@@ -0,0 +1,167 @@
+/*
+ * File:   Fields.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Fields.h"
+#include <cstring>
+
+using namespace std;
+
+FieldTransformer::FieldTransformer(const FieldOptions& options, const Function& function)
+    : m_options(options), m_function(function)
+{
+}
+
+void FieldTransformer::content(const char * data, size_t length, string& output)
+{
+    if (selected())
+        m_value.append(data, length);
+    else
+        output.append(data, length);
+}
+
+utf8proc_ssize_t FieldTransformer::endField(string& output)
+{
+    if (selected())
+    {
+        m_result.clear();
+        const utf8proc_ssize_t nb = m_function(m_value, m_result);
+        if (nb < 0)
+            return nb;
+        const char specials[] = {m_options.delimiter, '"', '\r', '\n', '\0'};
+        if (m_options.quoted && (m_wasQuoted || m_result.find_first_of(specials) != string::npos))
+        {
+            output.push_back('"');
+            size_t start = 0;
+            size_t quote;
+            while ((quote = m_result.find('"', start)) != string::npos)
+            {
+                output.append(m_result, start, quote + 1 - start);
+                output.push_back('"');
+                start = quote + 1;
+            }
+            output.append(m_result, start);
+            output.push_back('"');
+        }
+        else
+        {
+            output += m_result;
+        }
+    }
+    m_value.clear();
+    m_index++;
+    m_state = FIELD_START;
+    m_wasQuoted = false;
+    return 0;
+}
+
+utf8proc_ssize_t FieldTransformer::feed(const char * data, size_t length, string& output)
+{
+    size_t pos = 0;
+    while (pos < length)
+    {
+        switch (m_state)
+        {
+            case FIELD_START:
+                m_state = UNQUOTED;
+                if (m_options.quoted && data[pos] == '"')
+                {
+                    m_state = QUOTED;
+                    m_wasQuoted = true;
+                    if (!selected())
+                        output.push_back('"');
+                    pos++;
+                }
+                break;
+            case UNQUOTED:
+            case AFTER_QUOTED: // Leniently, what follows the closing quote is content.
+            {
+                const char * delimiter = (const char*) memchr(data + pos, m_options.delimiter, length - pos);
+                const size_t end = delimiter ? delimiter - data : length;
+                content(data + pos, end - pos, output);
+                pos = end;
+                if (delimiter)
+                {
+                    const utf8proc_ssize_t nb = endField(output);
+                    if (nb < 0)
+                        return nb;
+                    output.push_back(m_options.delimiter);
+                    pos++;
+                }
+            }
+                break;
+            case QUOTED:
+            {
+                const char * quote = (const char*) memchr(data + pos, '"', length - pos);
+                const size_t end = quote ? quote - data : length;
+                content(data + pos, end - pos, output);
+                pos = end;
+                if (quote)
+                {
+                    m_state = QUOTE;
+                    if (!selected())
+                        output.push_back('"');
+                    pos++;
+                }
+            }
+                break;
+            case QUOTE: // Doubled, or closing the quoted content.
+                if (data[pos] == '"')
+                {
+                    content(data + pos, 1, output);
+                    m_state = QUOTED;
+                    pos++;
+                }
+                else
+                {
+                    m_state = AFTER_QUOTED;
+                }
+                break;
+        }
+    }
+    return 0;
+}
+
+utf8proc_ssize_t FieldTransformer::end(string& output, char terminator)
+{
+    if (m_state == QUOTED)
+    {
+        content(&terminator, 1, output);
+        return 0;
+    }
+    bool cr = false;
+    if (selected() && !m_value.empty() && m_value.back() == '\r')
+    {
+        m_value.pop_back();
+        cr = true;
+    }
+    const utf8proc_ssize_t nb = endField(output);
+    if (nb < 0)
+        return nb;
+    if (cr)
+        output.push_back('\r');
+    output.push_back(terminator);
+    m_index = 0;
+    return 0;
+}
+
+utf8proc_ssize_t FieldTransformer::finish(string& output, char terminator)
+{
+    if (m_state != QUOTED)
+        return 0;
+    if (!selected()) // Copied as it is, up to the end.
+    {
+        m_state = FIELD_START;
+        m_index = 0;
+        return 0;
+    }
+    if (!m_value.empty() && m_value.back() == terminator)
+        m_value.pop_back();
+    m_state = AFTER_QUOTED;
+    return end(output, terminator);
+}
@@ -0,0 +1,72 @@
+/*
+ * File:   Fields.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef FIELDS_H
+#define FIELDS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <utf8proc.h>
+
+struct FieldOptions
+{
+    // Whether each field, from the first one, is transformed; those beyond are not.
+    std::vector<bool> selected;
+    char delimiter = '\t';
+    // Fields may be enclosed in double quotes, as in RFC 4180 CSV.
+    bool quoted = false;
+};
+
+/*
+ * Transforms the selected fields of delimited records, fed line by line in
+ * pieces, and copies the other fields and the delimiters as they are.
+ * With quoting, a quoted field may span lines; its content is unescaped before
+ * being transformed, and the result is quoted again if it was quoted or if it
+ * holds a delimiter, a quote or a line break.
+ * The CR of a CRLF line end is not part of the last field.
+ */
+class FieldTransformer
+{
+public:
+    // Appends the transform of a field; returns 0 or a negative utf8proc error code.
+    typedef std::function<utf8proc_ssize_t(std::string_view field, std::string& output)> Function;
+    
+    FieldTransformer(const FieldOptions& options, const Function& function);
+    // Feeds the next piece of a line, holding whole codepoints.
+    // Returns 0 or a negative utf8proc error code.
+    utf8proc_ssize_t feed(const char * data, size_t length, std::string& output);
+    // Ends a line: appends 'terminator', or keeps it in a quoted field.
+    utf8proc_ssize_t end(std::string& output, char terminator = '\n');
+    /*
+     * Ends the input, after the last line: a selected field whose quote is
+     * still open is transformed and quoted again, followed by the line end
+     * that end() kept in it. Returns 0 or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t finish(std::string& output, char terminator = '\n');
+
+private:
+    enum State {FIELD_START, UNQUOTED, QUOTED, QUOTE, AFTER_QUOTED};
+    FieldOptions m_options;
+    Function m_function;
+    State m_state = FIELD_START;
+    size_t m_index = 0;
+    bool m_wasQuoted = false;
+    // Content of the selected field being read, and its transform.
+    std::string m_value;
+    std::string m_result;
+    
+    bool selected() const { return m_index < m_options.selected.size() && m_options.selected[m_index]; }
+    // Appends content of the current field to the value or, if it is not selected, to the output.
+    void content(const char * data, size_t length, std::string& output);
+    utf8proc_ssize_t endField(std::string& output);
+};
+
+#endif // FIELDS_H
@@ -0,0 +1,130 @@
+/*
+ * File:   QuickCheck.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "QuickCheck.h"
+#include "Transforms.h"
+#include "Ascii.h"
+
+using namespace std;
+
+QuickCheck::QuickCheck(int options)
+    : m_options(options & ~UTF8PROC_NULLTERM), m_asciiUnchanged(!(options & UTF8PROC_CASEFOLD))
+{
+}
+
+QuickCheck::~QuickCheck()
+{
+    for (atomic<Block*>& block : m_blocks)
+        delete block.load();
+}
+
+QuickCheckResult QuickCheck::compute(utf8proc_int32_t codepoint) const
+{
+    // Enough for the longest decomposition or case folding.
+    utf8proc_int32_t buffer[32];
+    int boundClass = 0;
+    utf8proc_ssize_t nb = utf8proc_decompose_char(codepoint, buffer, 32, utf8proc_option_t (m_options), &boundClass);
+    if (nb > 32)
+        return QUICKCHECK_NO;
+    if (nb >= 0 && (m_options & UTF8PROC_COMPOSE))
+        nb = utf8proc_normalize_utf32(buffer, nb, utf8proc_option_t (m_options));
+    if (nb != 1 || buffer[0] != codepoint)
+        return QUICKCHECK_NO;
+    return isStableStarter(codepoint) ? QUICKCHECK_YES : QUICKCHECK_MAYBE;
+}
+
+const QuickCheck::Block * QuickCheck::block(utf8proc_int32_t codepoint) const
+{
+    const size_t index = codepoint >> 8;
+    Block * block = m_blocks[index].load(memory_order_acquire);
+    if (block)
+        return block;
+    lock_guard<mutex> lock(m_mutex);
+    block = m_blocks[index].load(memory_order_relaxed);
+    if (block)
+        return block;
+    block = new Block();
+    const utf8proc_int32_t first = codepoint & ~0xFF;
+    for (int i = 0; i < 256; i++)
+    {
+        const QuickCheckResult result = compute(first + i);
+        if (result == QUICKCHECK_YES)
+            block->yes[i >> 6] |= (uint64_t) 1 << (i & 63);
+        else if (result == QUICKCHECK_NO)
+            block->no[i >> 6] |= (uint64_t) 1 << (i & 63);
+    }
+    m_blocks[index].store(block, memory_order_release);
+    return block;
+}
+
+QuickCheckResult QuickCheck::codepoint(utf8proc_int32_t codepoint) const
+{
+    if (codepoint < 0 || codepoint >= 0x110000)
+        return QUICKCHECK_NO;
+    const Block * bits = block(codepoint);
+    const int i = codepoint & 0xFF;
+    const uint64_t mask = (uint64_t) 1 << (i & 63);
+    if (bits->yes[i >> 6] & mask)
+        return QUICKCHECK_YES;
+    return (bits->no[i >> 6] & mask) ? QUICKCHECK_NO : QUICKCHECK_MAYBE;
+}
+
+size_t QuickCheck::stableCodepoint(const char * data, size_t length) const
+{
+    if (length == 0)
+        return 0;
+    utf8proc_int32_t codepoint = (unsigned char) data[0];
+    utf8proc_ssize_t nb = 1;
+    if (codepoint >= 0x80)
+    {
+        nb = utf8proc_iterate((const utf8proc_uint8_t*) data, length, &codepoint);
+        if (nb < 0)
+            return 0;
+    }
+    return (this->codepoint(codepoint) == QUICKCHECK_YES) ? nb : 0;
+}
+
+size_t QuickCheck::stablePrefix(const char * data, size_t length) const
+{
+    size_t pos = 0;
+    while (pos < length)
+    {
+        if (m_asciiUnchanged)
+        {
+            pos += printableAsciiPrefix(data + pos, length - pos);
+            if (pos == length)
+                break;
+        }
+        const size_t nb = stableCodepoint(data + pos, length - pos);
+        if (nb == 0)
+            break;
+        pos += nb;
+    }
+    return pos;
+}
+
+QuickCheckResult QuickCheck::check(const char * data, size_t length) const
+{
+    QuickCheckResult result = QUICKCHECK_YES;
+    size_t pos = stablePrefix(data, length);
+    while (pos < length)
+    {
+        utf8proc_int32_t codepoint;
+        const utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t*) data + pos, length - pos, &codepoint);
+        if (nb < 0)
+            return QUICKCHECK_NO;
+        const QuickCheckResult current = this->codepoint(codepoint);
+        if (current == QUICKCHECK_NO)
+            return QUICKCHECK_NO;
+        if (current == QUICKCHECK_MAYBE)
+            result = QUICKCHECK_MAYBE;
+        pos += nb;
+    }
+    return result;
+}
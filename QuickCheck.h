@@ -0,0 +1,65 @@
+/*
+ * File:   QuickCheck.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef QUICKCHECK_H
+#define QUICKCHECK_H
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <utf8proc.h>
+
+enum QuickCheckResult
+{
+    QUICKCHECK_YES,
+    QUICKCHECK_MAYBE,
+    QUICKCHECK_NO
+};
+
+/*
+ * Normalization quick check, in the manner of the NF*_Quick_Check properties,
+ * for a set of utf8proc normalization options.
+ * YES: a stable starter that the normalization leaves unchanged; the input can
+ * be cut before it.
+ * MAYBE: left unchanged alone, but may be reordered or composed with its
+ * neighbours.
+ * NO: altered by the normalization.
+ * The properties are derived from utf8proc, per block of 256 codepoints, on
+ * first use; the tables can be shared by threads.
+ */
+class QuickCheck
+{
+public:
+    explicit QuickCheck(int options);
+    ~QuickCheck();
+    QuickCheckResult codepoint(utf8proc_int32_t codepoint) const;
+    // Length of the first codepoint if it is YES, 0 otherwise.
+    size_t stableCodepoint(const char * data, size_t length) const;
+    // Length of the leading YES codepoints.
+    size_t stablePrefix(const char * data, size_t length) const;
+    // YES if all codepoints are, NO if one is NO or the input is invalid, MAYBE otherwise.
+    QuickCheckResult check(const char * data, size_t length) const;
+
+private:
+    struct Block
+    {
+        uint64_t yes[4];
+        uint64_t no[4];
+    };
+    int m_options;
+    // Without case folding, ASCII characters are never altered.
+    bool m_asciiUnchanged;
+    mutable std::atomic<Block*> m_blocks[0x110000 >> 8] = {};
+    mutable std::mutex m_mutex;
+
+    const Block * block(utf8proc_int32_t codepoint) const;
+    QuickCheckResult compute(utf8proc_int32_t codepoint) const;
+};
+
+#endif // QUICKCHECK_H
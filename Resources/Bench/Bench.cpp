@@ -0,0 +1,506 @@
+/*
+ * File:   Bench.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <getopt.h>
+#include <utf8proc.h>
+#include "U7.h"
+#include "Encoding.h"
+#include "Allocations.h"
+
+using namespace std;
+
+/*
+ * Measures the operations of the u7 library on generated corpora, record by
+ * record as the stream mode does, and prints the results as JSON, one result
+ * per line, so that the output of two commits can be compared with --compare.
+ */
+
+struct Corpus
+{
+    string name;
+    vector<string> records;
+    size_t bytes = 0;
+    size_t codepoints = 0;
+};
+
+struct BenchCase
+{
+    string name;
+    function<utf8proc_ssize_t(string_view record, string& output)> run;
+};
+
+struct BenchResult
+{
+    string corpus;
+    string name;
+    double bytesPerSecond;
+    double codepointsPerSecond;
+    double allocationsPerRecord;
+};
+
+static void appendCodepoint(string& output, utf8proc_int32_t codepoint)
+{
+    utf8proc_uint8_t bytes[4];
+    output.append((const char*) bytes, utf8proc_encode_char(codepoint, bytes));
+}
+
+/*
+ * Records of words separated by spaces; 'word' appends one word.
+ */
+static Corpus generate(const string& name, size_t nbOfRecords, mt19937& random,
+                       const function<void(string& record, mt19937& random)>& word)
+{
+    Corpus corpus;
+    corpus.name = name;
+    uniform_int_distribution<int> nbOfWords(6, 20);
+    for (size_t i = 0; i < nbOfRecords; i++)
+    {
+        string record;
+        const int words = nbOfWords(random);
+        for (int w = 0; w < words; w++)
+        {
+            if (w)
+                record.push_back(' ');
+            word(record, random);
+        }
+        corpus.bytes += record.size();
+        for (unsigned char c : record)
+            corpus.codepoints += (c & 0xC0) != 0x80;
+        corpus.records.push_back(std::move(record));
+    }
+    return corpus;
+}
+
+static vector<Corpus> corpora(size_t nbOfRecords)
+{
+    mt19937 random(7); // Identical corpora from run to run.
+    auto pick = [](mt19937& random, int first, int last) {
+        return uniform_int_distribution<int>(first, last)(random);
+    };
+    vector<Corpus> result;
+    
+    result.push_back(generate("ascii", nbOfRecords, random, [&](string& record, mt19937& random) {
+        const int length = pick(random, 2, 10);
+        for (int i = 0; i < length; i++)
+            record.push_back(pick(random, 0, 5) ? 'a' + pick(random, 0, 25) : 'A' + pick(random, 0, 25));
+        if (!pick(random, 0, 7))
+            record.push_back(",.;:!?"[pick(random, 0, 5)]);
+    }));
+    
+    // Precomposed, and sometimes decomposed, accented letters among plain ones.
+    const utf8proc_int32_t accented[] = {0xE0, 0xE1, 0xE2, 0xE4, 0xE7, 0xE8, 0xE9, 0xEA, 0xEB, 0xEE, 0xEF, 0xF1,
+                                         0xF4, 0xF6, 0xF9, 0xFB, 0xFC, 0xFF, 0xDF, 0x153, 0xC9, 0xC0, 0x107, 0x161};
+    result.push_back(generate("latin", nbOfRecords, random, [&](string& record, mt19937& random) {
+        const int length = pick(random, 2, 10);
+        for (int i = 0; i < length; i++)
+        {
+            const int draw = pick(random, 0, 9);
+            if (draw < 7)
+            {
+                record.push_back('a' + pick(random, 0, 25));
+            }
+            else if (draw < 9)
+            {
+                appendCodepoint(record, accented[pick(random, 0, size(accented) - 1)]);
+            }
+            else
+            {
+                record.push_back("aeiou"[pick(random, 0, 4)]);
+                appendCodepoint(record, 0x300 + pick(random, 0, 8)); // Combining accent.
+            }
+        }
+    }));
+    
+    // Letters, most of them followed by a haraka, sometimes with a shadda.
+    result.push_back(generate("arabic", nbOfRecords, random, [&](string& record, mt19937& random) {
+        const int length = pick(random, 2, 7);
+        for (int i = 0; i < length; i++)
+        {
+            appendCodepoint(record, pick(random, 0x628, 0x64A));
+            if (!pick(random, 0, 7))
+                appendCodepoint(record, 0x651);
+            if (pick(random, 0, 4) < 3)
+                appendCodepoint(record, pick(random, 0x64B, 0x652));
+        }
+    }));
+    
+    result.push_back(generate("cjk", nbOfRecords, random, [&](string& record, mt19937& random) {
+        const int length = pick(random, 3, 15);
+        for (int i = 0; i < length; i++)
+            appendCodepoint(record, pick(random, 0x4E00, 0x9FFF));
+        appendCodepoint(record, pick(random, 0, 1) ? 0x3002 : 0x3001);
+    }));
+    
+    // Syllables, and sometimes conjoining jamos that compose into syllables.
+    result.push_back(generate("hangul", nbOfRecords, random, [&](string& record, mt19937& random) {
+        const int length = pick(random, 1, 4);
+        for (int i = 0; i < length; i++)
+        {
+            if (pick(random, 0, 9))
+            {
+                appendCodepoint(record, pick(random, 0xAC00, 0xD7A3));
+                continue;
+            }
+            appendCodepoint(record, pick(random, 0x1100, 0x1112));
+            appendCodepoint(record, pick(random, 0x1161, 0x1175));
+            if (pick(random, 0, 1))
+                appendCodepoint(record, pick(random, 0x11A8, 0x11C2));
+        }
+    }));
+    
+    // ZWJ sequences, modifiers, flags and presentation selectors between words.
+    const vector<vector<utf8proc_int32_t>> emojis = {
+        {0x1F468, 0x200D, 0x1F469, 0x200D, 0x1F467, 0x200D, 0x1F466},
+        {0x1F469, 0x1F3FD, 0x200D, 0x1F4BB},
+        {0x1F3F3, 0xFE0F, 0x200D, 0x1F308},
+        {0x1F44D, 0x1F3FB},
+        {0x1F1EB, 0x1F1F7},
+        {0x2764, 0xFE0F},
+        {0x1F600}};
+    result.push_back(generate("emoji", nbOfRecords, random, [&](string& record, mt19937& random) {
+        if (pick(random, 0, 2))
+        {
+            for (utf8proc_int32_t codepoint : emojis[pick(random, 0, emojis.size() - 1)])
+                appendCodepoint(record, codepoint);
+            return;
+        }
+        const int length = pick(random, 2, 8);
+        for (int i = 0; i < length; i++)
+            record.push_back('a' + pick(random, 0, 25));
+    }));
+    
+    // Fields separated by tabs, which are control characters.
+    result.push_back(generate("tabular", nbOfRecords, random, [&](string& record, mt19937& random) {
+        const int fields = pick(random, 1, 3);
+        for (int field = 0; field < fields; field++)
+        {
+            if (field)
+                record.push_back('\t');
+            const int length = pick(random, 1, 8);
+            for (int i = 0; i < length; i++)
+                record.push_back(pick(random, 0, 3) ? 'a' + pick(random, 0, 25) : '0' + pick(random, 0, 9));
+        }
+    }));
+    return result;
+}
+
+static vector<BenchCase> cases()
+{
+    vector<BenchCase> result;
+    // Every combination of the flags of unaccent.
+    const char flags[] = "icmnr";
+    for (int mask = 0; mask < 32; mask++)
+    {
+        u7::UnaccentOptions options;
+        options.keepIgnorable = mask & 1;
+        options.keepControl = mask & 2;
+        options.keepMarks = mask & 4;
+        options.keepUnassigned = mask & 8;
+        options.recompose = mask & 16;
+        string name("unaccent");
+        if (mask)
+        {
+            name += " -";
+            for (int bit = 0; bit < 5; bit++)
+            {
+                if (mask & (1 << bit))
+                    name.push_back(flags[bit]);
+            }
+        }
+        result.push_back({name, [options](string_view record, string& output) {
+            return u7::unaccent(record, options, output);
+        }});
+    }
+    
+    const char * const types[] = {"NFC", "NFD", "NFKC", "NFKD", "NFKC_Casefold"};
+    for (const char * type : types)
+    {
+        u7::NormalizeOptions options;
+        u7::normalizationForm(type, options.form);
+        result.push_back({string("normalize -t ") + type, [options](string_view record, string& output) {
+            return u7::normalize(record, options, output);
+        }});
+    }
+    
+    const char caseFlags[] = "LUTC"; // In the order of u7::CaseMapping.
+    for (int mapping = u7::CASE_LOWER; mapping <= u7::CASE_FOLD; mapping++)
+    {
+        u7::CaseOptions options;
+        options.mapping = u7::CaseMapping(mapping);
+        result.push_back({string("case -") + caseFlags[mapping], [options](string_view record, string& output) {
+            return u7::mapCase(record, options, output);
+        }});
+    }
+    
+    u7::SearchKeyOptions searchKey;
+    result.push_back({"searchkey", [searchKey](string_view record, string& output) {
+        return u7::searchKey(record, searchKey, output);
+    }});
+    // The same work as 'normalize -t NFKC_Casefold | unaccent -r'.
+    result.push_back({"normalize -t NFKC_Casefold | unaccent -r", [](string_view record, string& output) {
+        thread_local string casefolded;
+        casefolded.clear();
+        u7::NormalizeOptions normalize;
+        normalize.form = u7::NFKC_CASEFOLD;
+        u7::UnaccentOptions unaccent;
+        unaccent.recompose = true;
+        const utf8proc_ssize_t nb = u7::normalize(record, normalize, casefolded);
+        return nb < 0 ? nb : u7::unaccent(casefolded, unaccent, output);
+    }});
+    searchKey.collapseSpaces = true;
+    result.push_back({"searchkey -w", [searchKey](string_view record, string& output) {
+        return u7::searchKey(record, searchKey, output);
+    }});
+    
+    // The corpora are valid, so that this measures what --repair costs on clean input.
+    u7::RepairOptions repair;
+    result.push_back({"--repair", [repair](string_view record, string& output) {
+        return (utf8proc_ssize_t) u7::repair(record, repair, output);
+    }});
+    
+    TextEncoding utf16;
+    encodingName("UTF-16LE", utf16);
+    result.push_back({"transcode -t UTF-16LE", [utf16](string_view record, string& output) {
+        TextEncoder encoder(utf16);
+        encoder.encode(record, output);
+        return (utf8proc_ssize_t) output.size();
+    }});
+    // Decodes what the case above encodes.
+    result.push_back({"transcode -f UTF-16LE", [utf16](string_view record, string& output) {
+        thread_local string encoded;
+        thread_local vector<u7::InvalidSequence> invalid;
+        encoded.clear();
+        TextEncoder(utf16).encode(record, encoded);
+        TextDecoder decoder(utf16, false);
+        output.resize(encoded.size() * TextDecoder::EXPANSION);
+        size_t written;
+        decoder.decode(encoded.data(), encoded.size(), true, output.data(), written, invalid);
+        output.resize(written);
+        return (utf8proc_ssize_t) written;
+    }});
+    
+    result.push_back({"stats", [](string_view record, string&) {
+        thread_local u7::PropertyCensus census;
+        u7::countProperties(record, census);
+        return (utf8proc_ssize_t) 0;
+    }});
+    
+    u7::SegmentOptions segment;
+    result.push_back({"segment", [segment](string_view record, string& output) {
+        return u7::segment(record, segment, output);
+    }});
+    segment.width = 20;
+    result.push_back({"segment -w 20", [segment](string_view record, string& output) {
+        return u7::segment(record, segment, output);
+    }});
+    
+    u7::RepresentationOptions representation;
+    representation.columns = {u7::CODEPOINT, u7::UTF8, u7::UTF16, u7::BINARY, u7::OCTAL, u7::DECIMAL, u7::XML,
+                              u7::TOLOWER, u7::TOUPPER, u7::TOTITLE};
+    result.push_back({"representation --all", [representation](string_view record, string& output) {
+        return u7::representation(record, representation, output);
+    }});
+    u7::PropertiesOptions properties;
+    properties.columns = {u7::ISLOWER, u7::ISUPPER, u7::CATEGORY, u7::DIRECTION, u7::DECOMPOSITION_TYPE,
+                          u7::BOUNDCLASS};
+    result.push_back({"properties --all", [properties](string_view record, string& output) {
+        return u7::properties(record, properties, output);
+    }});
+    properties.format = u7::ROW_JSON;
+    result.push_back({"properties --all --format json", [properties](string_view record, string& output) {
+        return u7::properties(record, properties, output);
+    }});
+    return result;
+}
+
+/*
+ * Runs a case over the whole corpus until 'seconds' have elapsed, after a
+ * first pass that lets the buffers grow.
+ */
+static BenchResult measure(const Corpus& corpus, const BenchCase& benchCase, double seconds)
+{
+    string output;
+    auto pass = [&]() {
+        for (const string& record : corpus.records)
+        {
+            output.clear();
+            benchCase.run(record, output);
+        }
+    };
+    pass();
+    
+    const AllocationCounters before = allocationCounters();
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    size_t passes = 0;
+    double elapsed = 0;
+    do
+    {
+        pass();
+        passes++;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+    const AllocationCounters after = allocationCounters();
+    
+    BenchResult result;
+    result.corpus = corpus.name;
+    result.name = benchCase.name;
+    result.bytesPerSecond = corpus.bytes * passes / elapsed;
+    result.codepointsPerSecond = corpus.codepoints * passes / elapsed;
+    result.allocationsPerRecord = double(after.allocations - before.allocations) / (corpus.records.size() * passes);
+    return result;
+}
+
+static string key(const string& corpus, const string& name)
+{
+    return corpus + "/" + name;
+}
+
+// Value of a string or number field of a result line.
+static string field(const string& line, const string& name)
+{
+    const string quoted = "\"" + name + "\": ";
+    size_t start = line.find(quoted);
+    if (start == string::npos)
+        return "";
+    start += quoted.size();
+    if (line[start] == '"')
+        return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+    return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+// Bytes per second of each result of a previous run, by corpus and case.
+static bool readBaseline(const string& path, map<string, double>& baseline)
+{
+    ifstream file(path);
+    if (!file)
+        return false;
+    string line;
+    while (getline(file, line))
+    {
+        const string corpus = field(line, "corpus");
+        if (!corpus.empty())
+            baseline[key(corpus, field(line, "case"))] = atof(field(line, "bytes_per_second").c_str());
+    }
+    return true;
+}
+
+static void showHelp()
+{
+    cout << "Measures the operations of utf8util on generated corpora: ascii, latin, arabic, cjk, hangul, emoji, tabular."
+    "\nThe results are printed on stdout as JSON."
+    "\n\n  -t, --time: seconds spent on each case of each corpus; 0.2 by default"
+    "\n  -r, --records: records per corpus; 2000 by default"
+    "\n  -f, --filter: only run the cases whose corpus/case name contains this string"
+    "\n  -c, --compare: JSON output of a previous run; regressions are reported on stderr"
+    "\n  -T, --tolerance: slowdown in percent reported as a regression; 10 by default"
+    "\n  -h, --help: show this message"
+    "\n\nThe exit code is 1 if a case regressed beyond the tolerance." << endl;
+}
+
+int main(int argc, char ** argv)
+{
+    startAllocationCount();
+    double seconds = 0.2;
+    size_t nbOfRecords = 2000;
+    string filter;
+    string baselinePath;
+    double tolerance = 10;
+    
+    option longopts[] = {
+        {"time", required_argument, 0, 't'},
+        {"records", required_argument, 0, 'r'},
+        {"filter", required_argument, 0, 'f'},
+        {"compare", required_argument, 0, 'c'},
+        {"tolerance", required_argument, 0, 'T'},
+        {"help", no_argument, 0, 'h'},
+        {0}};
+    
+    while (1) {
+        const int opt = getopt_long(argc, argv, "t:r:f:c:T:h", longopts, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 't':
+                seconds = atof(optarg);
+                break;
+            case 'r':
+                nbOfRecords = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'c':
+                baselinePath = optarg;
+                break;
+            case 'T':
+                tolerance = atof(optarg);
+                break;
+            case 'h':
+                showHelp();
+                return 0;
+            default:
+                return 2;
+        }
+    }
+    if (nbOfRecords == 0)
+        nbOfRecords = 1;
+    
+    map<string, double> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline))
+    {
+        cerr << "Cannot read " << baselinePath << endl;
+        return 2;
+    }
+    
+    bool regressed = false;
+    bool first = true;
+    cout << "{\"utf8proc\": \"" << utf8proc_version() << "\", \"records\": " << nbOfRecords
+         << ", \"results\": [" << endl;
+    const vector<BenchCase> benchCases = cases();
+    for (const Corpus& corpus : corpora(nbOfRecords))
+    {
+        for (const BenchCase& benchCase : benchCases)
+        {
+            if (!filter.empty() && key(corpus.name, benchCase.name).find(filter) == string::npos)
+                continue;
+            const BenchResult result = measure(corpus, benchCase, seconds);
+            cout << (first ? "" : ",\n") << fixed << setprecision(0)
+                 << "{\"corpus\": \"" << result.corpus << "\", \"case\": \"" << result.name
+                 << "\", \"bytes_per_second\": " << result.bytesPerSecond
+                 << ", \"codepoints_per_second\": " << result.codepointsPerSecond
+                 << setprecision(3) << ", \"allocations_per_record\": " << result.allocationsPerRecord << "}";
+            first = false;
+            
+            auto previous = baseline.find(key(result.corpus, result.name));
+            if (previous == baseline.end() || previous->second <= 0)
+                continue;
+            const double change = (result.bytesPerSecond / previous->second - 1) * 100;
+            const bool slower = change < -tolerance;
+            regressed |= slower;
+            cerr << fixed << setprecision(1) << setw(8) << showpos << change << noshowpos << "%  "
+                 << key(result.corpus, result.name) << (slower ? "  REGRESSION" : "") << endl;
+        }
+    }
+    cout << "\n]}" << endl;
+    return regressed ? 1 : 0;
+}
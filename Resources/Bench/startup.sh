@@ -0,0 +1,56 @@
+#!/bin/bash
+# Time to first byte of one-shot invocations, as used by shell scripts that
+# call utf8util once per field.
+# $1: utf8util binary; default: utf8util in PATH
+# $2: number of runs per case; default: 200
+
+BIN=${1:-utf8util}
+RUNS=${2:-200}
+
+if ! command -v "$BIN" > /dev/null
+then
+    echo "\$1: utf8util binary; example: ../../build/utf8util"
+    exit 0
+fi
+
+# Microseconds until the first byte of output, then until the process exits.
+measure()
+{
+    local INPUT="$1"
+    shift
+    local START FIRST END C
+    START=$(date +%s%N)
+    {
+        IFS= read -r -n 1 C
+        FIRST=$(date +%s%N)
+        cat > /dev/null
+    } < <(printf '%s\n' "$INPUT" | "$BIN" "$@")
+    wait
+    END=$(date +%s%N)
+    echo $(( (FIRST - START) / 1000 )) $(( (END - START) / 1000 ))
+}
+
+run()
+{
+    local NAME="$1"
+    shift
+    local TOTAL_FIRST=0 TOTAL_END=0 MIN_FIRST= FIRST END
+    for ((i = 0; i < RUNS; i++))
+    do
+        read FIRST END < <(measure "$@")
+        TOTAL_FIRST=$((TOTAL_FIRST + FIRST))
+        TOTAL_END=$((TOTAL_END + END))
+        [ -z "$MIN_FIRST" -o "$FIRST" -lt "${MIN_FIRST:-0}" ] && MIN_FIRST=$FIRST
+    done
+    printf "%-16s first byte: mean %6d us, min %6d us; exit: mean %6d us\n" \
+        "$NAME" $((TOTAL_FIRST / RUNS)) $MIN_FIRST $((TOTAL_END / RUNS))
+}
+
+echo "$BIN, $RUNS runs per case"
+run unaccent "Héllo wörld" unaccent
+run normalize "Héllo wörld" normalize -t NFD
+run representation "é" representation -p -e
+run properties "é" properties -c -d -b
+run about "" about
+
+exit 0
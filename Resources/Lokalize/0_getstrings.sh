@@ -19,7 +19,7 @@ DEST=$DOMAIN/$APPNAME.po
 [ -f $DEST ] && JOIN="-j"
 [ -f $DEST ] && cp $DEST $DEST.bak-$(date +%F-%T)
 
-xgettext --keyword=_ -d $DOMAIN $JOIN -o $DEST --c++ --from-code=UTF-8 $(find $SRC -maxdepth 1 -type f -name "*.cpp")
+xgettext --keyword=_ --keyword=N_ -d $DOMAIN $JOIN -o $DEST --c++ --from-code=UTF-8 $(find $SRC -maxdepth 1 -type f -name "*.cpp")
 #xgettext --keyword=_ -d $DOMAIN -j -o $DEST --c++ --from-code=UTF-8 $(find $SRC -maxdepth 1 -type f -name "*.h")
 
 exit 0
@@ -0,0 +1,130 @@
+/*
+ * File:   Segmenter.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Segmenter.h"
+#include "Ascii.h"
+#include <charconv>
+
+using namespace std;
+
+static int codepointWidth(utf8proc_int32_t codepoint)
+{
+    if (codepoint == 0xFE0F || (codepoint >= 0x1F1E6 && codepoint <= 0x1F1FF))
+        return 2;
+    return utf8proc_charwidth(codepoint);
+}
+
+static void appendNumber(size_t number, string& output)
+{
+    char buffer[24];
+    output.append(buffer, to_chars(buffer, buffer + sizeof(buffer), number).ptr - buffer);
+}
+
+Segmenter::Segmenter(size_t maxWidth)
+    : m_maxWidth(maxWidth)
+{
+}
+
+bool Segmenter::closeCluster(const char * data, size_t start, size_t end, string& output)
+{
+    if (m_previous < 0)
+        return true;
+    if (m_maxWidth)
+    {
+        if (m_width + m_clusterWidth > m_maxWidth)
+        {
+            m_full = true;
+            return false;
+        }
+        output += m_cluster;
+        output.append(data + start, end - start);
+        m_cluster.clear();
+    }
+    m_graphemes++;
+    m_width += m_clusterWidth;
+    return true;
+}
+
+utf8proc_ssize_t Segmenter::feed(const char * data, size_t length, string& output)
+{
+    if (m_full)
+        return 0;
+    size_t clusterStart = 0;
+    size_t pos = 0;
+    while (pos < length)
+    {
+        // A printable ASCII character after another one always starts a cluster of one column.
+        if (m_previous >= 0x20 && m_previous < 0x7F && isPrintableAscii((unsigned char) data[pos]))
+        {
+            const size_t run = printableAsciiPrefix(data + pos, length - pos);
+            if (!closeCluster(data, clusterStart, pos, output))
+                return 0;
+            // The last character of the run may be extended by what follows.
+            size_t whole = run - 1;
+            if (m_maxWidth && m_width + whole > m_maxWidth)
+            {
+                whole = m_maxWidth - m_width;
+                m_full = true;
+            }
+            if (m_maxWidth)
+                output.append(data + pos, whole);
+            m_graphemes += whole;
+            m_width += whole;
+            if (m_full)
+                return 0;
+            clusterStart = pos + whole;
+            m_clusterWidth = 1;
+            m_previous = (unsigned char) data[pos + whole];
+            m_state = 0;
+            pos += run;
+            continue;
+        }
+        utf8proc_int32_t codepoint = (unsigned char) data[pos];
+        utf8proc_ssize_t nb = 1;
+        if (codepoint >= 0x80)
+        {
+            nb = utf8proc_iterate((const utf8proc_uint8_t*) data + pos, length - pos, &codepoint);
+            if (nb < 0)
+                return nb;
+        }
+        if (m_previous >= 0 && utf8proc_grapheme_break_stateful(m_previous, codepoint, &m_state))
+        {
+            if (!closeCluster(data, clusterStart, pos, output))
+                return 0;
+            clusterStart = pos;
+            m_clusterWidth = 0;
+        }
+        m_clusterWidth = max(m_clusterWidth, codepointWidth(codepoint));
+        m_previous = codepoint;
+        pos += nb;
+    }
+    if (m_maxWidth)
+        m_cluster.append(data + clusterStart, length - clusterStart);
+    return 0;
+}
+
+void Segmenter::end(string& output, char terminator)
+{
+    if (!m_full)
+        closeCluster("", 0, 0, output);
+    if (!m_maxWidth)
+    {
+        appendNumber(m_graphemes, output);
+        output.push_back('\t');
+        appendNumber(m_width, output);
+    }
+    output.push_back(terminator);
+    m_graphemes = 0;
+    m_width = 0;
+    m_previous = -1;
+    m_state = 0;
+    m_clusterWidth = 0;
+    m_cluster.clear();
+    m_full = false;
+}
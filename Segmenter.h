@@ -0,0 +1,52 @@
+/*
+ * File:   Segmenter.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <string>
+#include <utf8proc.h>
+
+/*
+ * Walks the grapheme clusters of a line, fed in pieces, adding up their number
+ * and their display width; or copies the line truncated to a number of columns
+ * without splitting a cluster.
+ * The width of a cluster is the largest width of its codepoints; regional
+ * indicators, paired into flags, and the emoji presentation selector make it
+ * two columns wide. Runs of printable ASCII characters skip the state machine.
+ */
+class Segmenter
+{
+public:
+    // 'maxWidth' columns are kept per line; 0 to count instead.
+    explicit Segmenter(size_t maxWidth = 0);
+    // Feeds the next piece of the line, holding whole codepoints.
+    // Returns 0 or a negative utf8proc error code.
+    utf8proc_ssize_t feed(const char * data, size_t length, std::string& output);
+    // Appends the count and the width, tab separated, or what is left of the truncated line, then 'terminator'.
+    void end(std::string& output, char terminator = '\n');
+
+private:
+    size_t m_maxWidth;
+    size_t m_graphemes = 0;
+    size_t m_width = 0;
+    // Last codepoint of the line, -1 at its start, and the state of utf8proc_grapheme_break_stateful().
+    utf8proc_int32_t m_previous = -1;
+    utf8proc_int32_t m_state = 0;
+    // Columns of the cluster being walked, and its bytes from the previous pieces when truncating.
+    int m_clusterWidth = 0;
+    std::string m_cluster;
+    // Set once a cluster does not fit; the rest of the line is skipped.
+    bool m_full = false;
+
+    // Ends the cluster being walked, at 'end' in 'data'; false if it does not fit.
+    bool closeCluster(const char * data, size_t start, size_t end, std::string& output);
+};
+
+#endif // SEGMENTER_H
@@ -0,0 +1,208 @@
+/*
+ * File:   Serve.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Serve.h"
+#include <iostream>
+#include <thread>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <libintl.h>
+#include "Stream.h"
+
+using namespace std;
+
+#define _(STRING) gettext(STRING)
+
+// Bytes requested from a connection at once.
+#define SERVE_READ_SIZE (1 << 16)
+// Longest accepted ARGS and LENGTH lines.
+#define SERVE_LINE_MAX 4096
+
+enum ParseResult {PARSE_COMPLETE, PARSE_INCOMPLETE, PARSE_MALFORMED};
+
+/*
+ * Extracts the request at the start of 'data'; 'consumed' is its size,
+ * delimiters included. At the end of the input, a NUL delimited request
+ * may lack its final NUL.
+ */
+static ParseResult parseRequest(string_view data, ServeFraming framing, bool eof,
+                                string_view& args, string_view& payload, size_t& consumed)
+{
+    if (framing == SERVE_NUL)
+    {
+        size_t end = data.find('\0');
+        if (end == string_view::npos)
+        {
+            // Such as the newline of 'echo'.
+            if (!eof || data.find_first_not_of('\n') == string_view::npos)
+                return PARSE_INCOMPLETE;
+            end = data.size();
+            consumed = end;
+        }
+        else
+        {
+            consumed = end + 1;
+        }
+        const string_view request = data.substr(0, end);
+        const size_t newline = request.find('\n');
+        args = request.substr(0, newline);
+        payload = newline == string_view::npos ? string_view() : request.substr(newline + 1);
+        return PARSE_COMPLETE;
+    }
+    
+    const size_t argsEnd = data.find('\n');
+    if (argsEnd == string_view::npos)
+        return data.size() > SERVE_LINE_MAX || eof ? PARSE_MALFORMED : PARSE_INCOMPLETE;
+    const size_t lengthEnd = data.find('\n', argsEnd + 1);
+    if (lengthEnd == string_view::npos)
+        return data.size() - argsEnd > SERVE_LINE_MAX || eof ? PARSE_MALFORMED : PARSE_INCOMPLETE;
+    size_t length = 0;
+    const char * first = data.data() + argsEnd + 1;
+    const char * last = data.data() + lengthEnd;
+    const from_chars_result parsed = from_chars(first, last, length);
+    if (first == last || parsed.ptr != last || parsed.ec != errc())
+        return PARSE_MALFORMED;
+    if (data.size() - lengthEnd - 1 < length)
+        return eof ? PARSE_MALFORMED : PARSE_INCOMPLETE;
+    args = data.substr(0, argsEnd);
+    payload = data.substr(lengthEnd + 1, length);
+    consumed = lengthEnd + 1 + length;
+    return PARSE_COMPLETE;
+}
+
+static void appendReply(string& output, ServeFraming framing, int status, string_view result)
+{
+    char number[24];
+    output.append(number, to_chars(number, number + sizeof(number), status).ptr);
+    if (framing == SERVE_NUL)
+    {
+        output.push_back('\t');
+        output.append(result);
+        output.push_back('\0');
+        return;
+    }
+    output.push_back(' ');
+    output.append(number, to_chars(number, number + sizeof(number), result.size()).ptr);
+    output.push_back('\n');
+    output.append(result);
+}
+
+/*
+ * Serves the requests read from 'in' until its end, replying on 'out'.
+ * Returns 0, 21 on I/O error or 62 after a malformed request.
+ */
+static int serveConnection(int in, int out, const ServeHandler& handler, ServeFraming framing)
+{
+    string buffer;
+    size_t start = 0;
+    bool eof = false;
+    OutputBuffer replies(out);
+    string result;
+    while (1)
+    {
+        ParseResult parsed = PARSE_INCOMPLETE;
+        while (start < buffer.size())
+        {
+            string_view args, payload;
+            size_t consumed = 0;
+            parsed = parseRequest(string_view(buffer).substr(start), framing, eof, args, payload, consumed);
+            if (parsed != PARSE_COMPLETE)
+                break;
+            start += consumed;
+            result.clear();
+            const int status = handler(args, payload, result);
+            appendReply(replies.data(), framing, status, result);
+            if (!replies.flushIfFull())
+                return 21;
+        }
+        if (parsed == PARSE_MALFORMED)
+        {
+            appendReply(replies.data(), framing, 62, _("Malformed request."));
+            return replies.flush() ? 62 : 21;
+        }
+        // Nothing complete is left; reply before waiting for more.
+        if (!replies.flush())
+            return 21;
+        if (eof)
+            return 0;
+        buffer.erase(0, start);
+        start = 0;
+        const size_t filled = buffer.size();
+        buffer.resize(filled + SERVE_READ_SIZE);
+        ssize_t nb;
+        do
+        {
+            nb = read(in, buffer.data() + filled, SERVE_READ_SIZE);
+        } while (nb < 0 && errno == EINTR);
+        if (nb < 0)
+            return 21;
+        buffer.resize(filled + nb);
+        eof = (nb == 0);
+    }
+}
+
+static int listenOn(const string& path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        cout << _("Socket path too long: ") << path << endl;
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    // A socket left by a previous server is replaced; any other file is kept.
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+        unlink(path.c_str());
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (const sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        cout << _("Cannot listen on ") << path << ": " << strerror(errno) << endl;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int serveRequests(const ServeHandlerFactory& factory, const ServeOptions& options)
+{
+    if (options.socket.empty())
+        return serveConnection(STDIN_FILENO, STDOUT_FILENO, factory(), options.framing);
+    
+    const int fd = listenOn(options.socket);
+    if (fd < 0)
+        return 61;
+    // A client that disconnects early must not terminate the server.
+    signal(SIGPIPE, SIG_IGN);
+    while (1)
+    {
+        const int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            cout << _("Cannot accept a connection: ") << strerror(errno) << endl;
+            close(fd);
+            return 61;
+        }
+        thread([client, &factory, &options]()
+        {
+            serveConnection(client, client, factory(), options.framing);
+            close(client);
+        }).detach();
+    }
+}
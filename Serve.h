@@ -0,0 +1,54 @@
+/*
+ * File:   Serve.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+
+/*
+ * How requests and replies are delimited.
+ *  NUL: request 'ARGS\nPAYLOAD\0', reply 'STATUS\tRESULT\0'.
+ *  Length: request 'ARGS\nLENGTH\nPAYLOAD', reply 'STATUS LENGTH\nRESULT'.
+ * ARGS is a mode followed by its options, separated by spaces.
+ */
+enum ServeFraming {SERVE_NUL, SERVE_LENGTH};
+
+/*
+ * Serves one request: appends the result, or an error message, to 'result'
+ * and returns the status, 0 on success.
+ */
+typedef std::function<int(std::string_view args, std::string_view payload, std::string& result)> ServeHandler;
+
+/*
+ * Creates the handler of a connection; a handler is only called from the
+ * thread of its connection.
+ */
+typedef std::function<ServeHandler()> ServeHandlerFactory;
+
+struct ServeOptions
+{
+    ServeFraming framing = SERVE_NUL;
+    // Unix-domain socket to listen on; stdin and stdout if empty.
+    std::string socket;
+};
+
+/*
+ * Serves requests until the end of stdin, or forever on a socket, each
+ * connection on its own thread. Requests can be pipelined: replies are sent
+ * in order, and are written when no complete request remains to be read.
+ * A malformed request is answered with status 62 and closes the connection.
+ * Returns 0, 21 on I/O error, 61 if the socket cannot be set up or 62 after
+ * a malformed request on stdin.
+ */
+int serveRequests(const ServeHandlerFactory& factory, const ServeOptions& options);
+
+#endif // SERVE_H
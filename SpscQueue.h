@@ -0,0 +1,76 @@
+/*
+ * File:   SpscQueue.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * A bounded queue between one producer thread and one consumer thread, without
+ * locks. A thread that finds the queue full, or empty, sleeps on the index it
+ * waits for to move.
+ * 'Capacity' must be a power of 2.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of 2.");
+
+public:
+    // Producer side; waits while the queue is full.
+    void push(const T& value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        while (tail - head == Capacity)
+        {
+            m_head.wait(head, std::memory_order_acquire);
+            head = m_head.load(std::memory_order_acquire);
+        }
+        m_items[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_tail.notify_one();
+    }
+    // Consumer side; false if the queue is empty.
+    bool tryPop(T& value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail.load(std::memory_order_acquire) == head)
+            return false;
+        value = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        m_head.notify_one();
+        return true;
+    }
+    // Consumer side; waits while the queue is empty.
+    T pop()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        while (tail == head)
+        {
+            m_tail.wait(tail, std::memory_order_acquire);
+            tail = m_tail.load(std::memory_order_acquire);
+        }
+        T value = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        m_head.notify_one();
+        return value;
+    }
+
+private:
+    T m_items[Capacity];
+    // Each index is written by one side only, on its own cache line.
+    alignas(64) std::atomic<size_t> m_head = 0;
+    alignas(64) std::atomic<size_t> m_tail = 0;
+};
+
+#endif // SPSCQUEUE_H
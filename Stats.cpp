@@ -0,0 +1,145 @@
+/*
+ * File:   Stats.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Stats.h"
+#include <chrono>
+#include <array>
+#include <cstring>
+#include "Allocations.h"
+#include "Descriptions.h"
+
+using namespace std;
+
+uint64_t monotonicNanoseconds()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+StreamStats::StreamStats(char delimiter)
+    : delimiter(delimiter), startTime(monotonicNanoseconds()), lastIn(delimiter), lastOut(delimiter)
+{
+}
+
+/*
+ * Counts the delimiters and the codepoints of 'data'; also the codepoints of
+ * its canonical decomposition per category if 'categories' is set. Invalid
+ * bytes are skipped.
+ */
+static void count(string_view data, char delimiter, uint64_t& records, uint64_t& codepoints,
+                  uint64_t * categories)
+{
+    const char * end = data.data() + data.size();
+    for (const char * pos = data.data(); (pos = (const char*) memchr(pos, delimiter, end - pos)); pos++)
+        records++;
+    const utf8proc_uint8_t * bytes = (const utf8proc_uint8_t*) data.data();
+    if (!categories)
+    {
+        for (size_t pos = 0; pos < data.size(); pos++)
+            codepoints += (bytes[pos] & 0xC0) != 0x80;
+        return;
+    }
+    static const auto asciiCategories = [] {
+        array<uint8_t, 0x80> table;
+        for (int c = 0; c < 0x80; c++)
+            table[c] = utf8proc_category(c);
+        return table;
+    }();
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        utf8proc_int32_t codepoint = bytes[pos];
+        if (codepoint < 0x80)
+        {
+            categories[asciiCategories[codepoint]]++;
+            codepoints++;
+            pos++;
+            continue;
+        }
+        const utf8proc_ssize_t nb = utf8proc_iterate(bytes + pos, data.size() - pos, &codepoint);
+        if (nb < 0)
+        {
+            pos++;
+            continue;
+        }
+        codepoints++;
+        pos += nb;
+        utf8proc_int32_t decomposed[32];
+        int boundClass = 0;
+        const utf8proc_ssize_t length = utf8proc_decompose_char(codepoint, decomposed, 32, UTF8PROC_DECOMPOSE,
+                                                                &boundClass);
+        if (length < 1 || length > 32)
+        {
+            categories[utf8proc_category(codepoint)]++;
+            continue;
+        }
+        for (utf8proc_ssize_t i = 0; i < length; i++)
+            categories[utf8proc_category(decomposed[i])]++;
+    }
+}
+
+void StreamStats::countInput(string_view data)
+{
+    if (data.empty())
+        return;
+    const uint64_t start = monotonicNanoseconds();
+    bytesIn += data.size();
+    count(data, delimiter, recordsIn, codepointsIn, categories ? categoriesIn : NULL);
+    lastIn = data.back();
+    countTime += monotonicNanoseconds() - start;
+}
+
+void StreamStats::countOutput(string_view data)
+{
+    if (data.empty())
+        return;
+    const uint64_t start = monotonicNanoseconds();
+    bytesOut += data.size();
+    count(data, delimiter, recordsOut, codepointsOut, categories ? categoriesOut : NULL);
+    lastOut = data.back();
+    countTime += monotonicNanoseconds() - start;
+}
+
+static string seconds(uint64_t nanoseconds)
+{
+    return to_string(nanoseconds / 1e9);
+}
+
+string StreamStats::report(const char * mode) const
+{
+    string json = string("{\"mode\": \"") + mode + "\"";
+    json += ", \"bytes_in\": " + to_string(bytesIn);
+    json += ", \"bytes_out\": " + to_string(bytesOut);
+    json += ", \"records_in\": " + to_string(recordsIn + (lastIn != delimiter));
+    json += ", \"records_out\": " + to_string(recordsOut + (lastOut != delimiter));
+    json += ", \"codepoints\": " + to_string(codepointsIn);
+    json += ", \"codepoints_out\": " + to_string(codepointsOut);
+    if (categories)
+    {
+        // Per category, what the decomposed output lacks compared to the decomposed input.
+        json += ", \"stripped\": {";
+        bool first = true;
+        for (int category = 0; category <= UTF8PROC_CATEGORY_CO; category++)
+        {
+            if (categoriesIn[category] <= categoriesOut[category])
+                continue;
+            json += first ? "\"" : ", \"";
+            json += categoryDescription(category);
+            json += "\": " + to_string(categoriesIn[category] - categoriesOut[category]);
+            first = false;
+        }
+        json += "}";
+    }
+    json += ", \"allocations\": " + to_string(allocationCounters().allocations);
+    json += ", \"seconds\": {\"read\": " + seconds(readTime);
+    json += ", \"transform\": " + seconds(transformTime);
+    json += ", \"write\": " + seconds(writeTime);
+    json += ", \"count\": " + seconds(countTime);
+    json += ", \"total\": " + seconds(monotonicNanoseconds() - startTime) + "}}";
+    return json;
+}
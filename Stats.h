@@ -0,0 +1,59 @@
+/*
+ * File:   Stats.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <atomic>
+#include <utf8proc.h>
+
+// Nanoseconds of a monotonic clock, for timing the phases of a stream.
+uint64_t monotonicNanoseconds();
+
+/*
+ * What a stream read, wrote and spent, for --stats. The stream functions
+ * update it once per chunk or per write, and only if StreamOptions::stats is
+ * set.
+ */
+struct StreamStats
+{
+    explicit StreamStats(char delimiter = '\n');
+    // Counts the bytes, records and codepoints of a chunk of input or of output.
+    void countInput(std::string_view data);
+    void countOutput(std::string_view data);
+    // A JSON object on a single line.
+    std::string report(const char * mode) const;
+
+    char delimiter;
+    // Codepoints per category are counted, in the canonical decomposition, to tell what was stripped.
+    bool categories = false;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t recordsIn = 0;
+    uint64_t recordsOut = 0;
+    uint64_t codepointsIn = 0;
+    uint64_t codepointsOut = 0;
+    uint64_t categoriesIn[UTF8PROC_CATEGORY_CO + 1] = {};
+    uint64_t categoriesOut[UTF8PROC_CATEGORY_CO + 1] = {};
+    // Nanoseconds; the transform time is summed over the threads.
+    uint64_t readTime = 0;
+    uint64_t transformTime = 0;
+    uint64_t writeTime = 0;
+    // Spent in countInput() and countOutput(), only with --stats; they may run on different threads.
+    std::atomic<uint64_t> countTime = 0;
+    uint64_t startTime;
+    // A last record without a delimiter is counted too.
+    char lastIn;
+    char lastOut;
+};
+
+#endif // STATS_H
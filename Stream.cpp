@@ -0,0 +1,1294 @@
+/*
+ * File:   Stream.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Stream.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <libintl.h>
+#include "ThreadPool.h"
+#include "SpscQueue.h"
+#include "Uring.h"
+#include "Ascii.h"
+#include "Transforms.h"
+#include "Stats.h"
+#include "Utf8.h"
+#include "U7.h"
+
+using namespace std;
+
+#define _(STRING) gettext(STRING)
+
+// Where to cut a chunk that is not the last one.
+static size_t chunkCut(const char * data, size_t available, char delimiter,
+                       const function<bool(utf8proc_int32_t codepoint)>& boundary)
+{
+    const char * newline = (const char*) memrchr(data, delimiter, available);
+    if (newline)
+        return newline - data + 1;
+    size_t cut = lastBoundary(data, available, boundary);
+    // A chunk full of combining marks is not text; just keep codepoints whole.
+    if (cut == 0)
+        cut = lastCodepointBoundary(data, available);
+    if (cut == 0)
+        cut = available;
+    return cut;
+}
+
+/*
+ * Tells on stderr where the input was ill-formed; 'offset' is added to the
+ * offsets of 'invalid'. Each line starts with 'source' and a colon, if set.
+ */
+static void printInvalid(const vector<u7::InvalidSequence>& invalid, uint64_t offset, const char * encoding,
+                         const string& source = string())
+{
+    for (const u7::InvalidSequence& sequence : invalid)
+        cerr << (source.empty() ? "" : source + ": ") << _("Invalid ") << encoding << _(" at byte ") << offset + sequence.offset << ", " << sequence.length
+             << (sequence.length == 1 ? _(" byte") : _(" bytes")) << '\n';
+}
+
+MappedFile::MappedFile(int fd)
+{
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0)
+        return;
+    void * data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        return;
+    madvise(data, status.st_size, MADV_SEQUENTIAL);
+    m_data = (const char*) data;
+    m_size = status.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap((void*) m_data, m_size);
+}
+
+ChunkReader::ChunkReader(int fd, size_t chunkSize, char delimiter)
+    : m_fd(fd), m_chunkSize(chunkSize), m_delimiter(delimiter), m_boundary(isStableStarter), m_data(NULL)
+{
+    // What is carried over from a chunk never exceeds a chunk.
+    m_buffer.resize(2 * chunkSize);
+}
+
+ChunkReader::ChunkReader(const char * data, size_t length, size_t chunkSize, char delimiter)
+    : m_fd(-1), m_chunkSize(chunkSize), m_delimiter(delimiter), m_boundary(isStableStarter), m_data(data),
+      m_end(length), m_eof(true)
+{
+}
+
+bool ChunkReader::fill()
+{
+    if (m_start > 0)
+    {
+        memmove(m_buffer.data(), m_buffer.data() + m_start, m_end - m_start);
+        m_end -= m_start;
+        m_start = 0;
+    }
+    while (!m_eof && m_end < m_chunkSize)
+    {
+        if (m_decoder)
+        {
+            if (!readDecoded())
+                return false;
+            continue;
+        }
+        const ssize_t nb = read(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end);
+        if (nb < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            m_error = errno;
+            return false;
+        }
+        if (nb == 0)
+            m_eof = true;
+        m_end += nb;
+    }
+    return true;
+}
+
+void ChunkReader::decode(const TextEncoding& encoding, bool drop)
+{
+    m_decoder = make_unique<TextDecoder>(encoding, drop);
+    m_encoding = encoding.encoding;
+    m_raw.resize(m_chunkSize);
+}
+
+// Reads once and decodes what is complete; the rest is kept at the start of 'm_raw'.
+bool ChunkReader::readDecoded()
+{
+    // Decoding may expand the input; what is read must fit in the buffer once decoded.
+    const size_t wanted = min(m_raw.size(), (m_buffer.size() - m_end) / TextDecoder::EXPANSION);
+    if (m_rawEnd < wanted)
+    {
+        const ssize_t nb = read(m_fd, m_raw.data() + m_rawEnd, wanted - m_rawEnd);
+        if (nb < 0)
+        {
+            if (errno == EINTR)
+                return true;
+            m_error = errno;
+            return false;
+        }
+        if (nb == 0)
+            m_eof = true;
+        m_rawEnd += nb;
+    }
+    size_t written = 0;
+    m_invalid.clear();
+    const size_t consumed = m_decoder->decode(m_raw.data(), m_rawEnd, m_eof, m_buffer.data() + m_end, written,
+                                              m_invalid);
+    // The decoder counts the offsets from the start of the input.
+    printInvalid(m_invalid, 0, encodingLabel(m_encoding));
+    m_end += written;
+    memmove(m_raw.data(), m_raw.data() + consumed, m_rawEnd - consumed);
+    m_rawEnd -= consumed;
+    return true;
+}
+
+bool ChunkReader::next(string_view& chunk)
+{
+    const char * data;
+    size_t available;
+    bool last;
+    if (m_fd < 0)
+    {
+        data = m_data + m_start;
+        available = min(m_chunkSize, m_end - m_start);
+        last = (m_start + available == m_end);
+    }
+    else
+    {
+        if (!fill())
+            return false;
+        data = m_buffer.data() + m_start;
+        available = m_end - m_start;
+        last = m_eof;
+    }
+    if (available == 0)
+        return false;
+    const size_t cut = last ? available : chunkCut(data, available, m_delimiter, m_boundary);
+    chunk = string_view(data, cut);
+    m_start += cut;
+    return true;
+}
+
+OutputBuffer::OutputBuffer(int fd, size_t capacity)
+    : m_fd(fd), m_capacity(capacity)
+{
+    m_data.reserve(capacity + capacity / 2);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    if (m_fd >= 0)
+        flush();
+}
+
+void OutputBuffer::reference(const char * data, size_t length)
+{
+    if (length == 0)
+        return;
+    if (m_data.size() > m_segmented)
+    {
+        m_segments.push_back({NULL, m_segmented, m_data.size() - m_segmented});
+        m_segmented = m_data.size();
+    }
+    if (!m_segments.empty() && m_segments.back().reference
+        && m_segments.back().reference + m_segments.back().length == data)
+        m_segments.back().length += length;
+    else
+        m_segments.push_back({data, 0, length});
+    m_referenced += length;
+}
+
+void OutputBuffer::clear()
+{
+    m_data.clear();
+    m_segments.clear();
+    m_segmented = 0;
+    m_referenced = 0;
+}
+
+// Writes all vectors, resuming after partial writes.
+static bool writeVectors(int fd, iovec * vectors, int count)
+{
+    while (count > 0)
+    {
+        ssize_t nb = writev(fd, vectors, count);
+        if (nb < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        while (count > 0 && (size_t) nb >= vectors->iov_len)
+        {
+            nb -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if (count > 0)
+        {
+            vectors->iov_base = (char*) vectors->iov_base + nb;
+            vectors->iov_len -= nb;
+        }
+    }
+    return true;
+}
+
+bool OutputBuffer::writeTo(int fd)
+{
+    vector<iovec>& vectors = gather();
+    bool ok = true;
+    for (size_t done = 0; ok && done < vectors.size(); done += IOV_MAX)
+        ok = writeVectors(fd, vectors.data() + done, min(vectors.size() - done, (size_t) IOV_MAX));
+    clear();
+    return ok;
+}
+
+vector<iovec>& OutputBuffer::gather()
+{
+    m_vectors.clear();
+    if (m_encoder)
+    {
+        m_encoded.clear();
+        visit([this](string_view data) { m_encoder->encode(data, m_encoded); });
+        m_vectors.push_back({m_encoded.data(), m_encoded.size()});
+        return m_vectors;
+    }
+    if (m_data.size() > m_segmented)
+    {
+        m_segments.push_back({NULL, m_segmented, m_data.size() - m_segmented});
+        m_segmented = m_data.size();
+    }
+    for (const Segment& segment : m_segments)
+        m_vectors.push_back({(void*) (segment.reference ? segment.reference : m_data.data() + segment.offset),
+                             segment.length});
+    return m_vectors;
+}
+
+void OutputBuffer::visit(const function<void(string_view data)>& visitor) const
+{
+    for (const Segment& segment : m_segments)
+        visitor(string_view(segment.reference ? segment.reference : m_data.data() + segment.offset, segment.length));
+    if (m_data.size() > m_segmented)
+        visitor(string_view(m_data.data() + m_segmented, m_data.size() - m_segmented));
+}
+
+// Adds the time elapsed during its life to 'total', unless null.
+struct PhaseTimer
+{
+    uint64_t * total;
+    uint64_t start;
+    explicit PhaseTimer(uint64_t * total) : total(total), start(total ? monotonicNanoseconds() : 0) {}
+    ~PhaseTimer()
+    {
+        if (total)
+            *total += monotonicNanoseconds() - start;
+    }
+};
+
+// Appends the repair of 'input' to 'output', telling where it was ill-formed; 'offset' is that of 'input'.
+static void repairInto(string_view input, uint64_t offset, InputRepair repair, string& output,
+                       vector<u7::InvalidSequence>& invalid)
+{
+    invalid.clear();
+    u7::RepairOptions options;
+    options.drop = (repair == REPAIR_DROP);
+    u7::repair(input, options, output, &invalid);
+    printInvalid(invalid, offset, "UTF-8");
+}
+
+void repairInput(string& input, InputRepair repair)
+{
+    if (repair == REPAIR_NONE)
+        return;
+    const size_t valid = validUtf8Prefix(input.data(), input.size());
+    if (valid == input.size())
+        return;
+    string repaired(input, 0, valid);
+    vector<u7::InvalidSequence> invalid;
+    repairInto(string_view(input).substr(valid), valid, repair, repaired, invalid);
+    input = std::move(repaired);
+}
+
+/*
+ * Repairs the chunks of a stream as they are read, keeping count of their
+ * offsets in the input. Chunks are cut before a delimiter or a leading byte,
+ * which ends any maximal subpart of an ill-formed subsequence, so that they can
+ * be repaired one at a time.
+ */
+class ChunkRepair
+{
+public:
+    // A decoded input is valid already.
+    explicit ChunkRepair(const StreamOptions& options) : m_mode(options.transcode ? REPAIR_NONE : options.repair) {}
+    // Points 'chunk' to its repaired copy if it is not valid UTF-8, and tells where it was not on stderr.
+    void apply(string_view& chunk);
+    // Whether the last chunk is a copy, valid until the next one.
+    bool repaired() const { return m_repaired; }
+
+private:
+    InputRepair m_mode;
+    uint64_t m_offset = 0;
+    bool m_repaired = false;
+    string m_buffer;
+    vector<u7::InvalidSequence> m_invalid;
+};
+
+void ChunkRepair::apply(string_view& chunk)
+{
+    const uint64_t offset = m_offset;
+    m_offset += chunk.size();
+    m_repaired = false;
+    if (m_mode == REPAIR_NONE)
+        return;
+    const size_t valid = validUtf8Prefix(chunk.data(), chunk.size());
+    if (valid == chunk.size())
+        return;
+    m_buffer.assign(chunk.data(), valid);
+    repairInto(chunk.substr(valid), offset + valid, m_mode, m_buffer, m_invalid);
+    chunk = m_buffer;
+    m_repaired = true;
+}
+
+// Reads and repairs the next chunk; counted and timed if 'stats' is set.
+static bool readChunk(ChunkReader& reader, string_view& chunk, StreamStats * stats, ChunkRepair& repair)
+{
+    bool more;
+    {
+        PhaseTimer timer(stats ? &stats->readTime : NULL);
+        more = reader.next(chunk);
+    }
+    if (!more)
+        return false;
+    // Timed as counting only, as the output is.
+    if (stats)
+        stats->countInput(chunk);
+    PhaseTimer timer(stats ? &stats->readTime : NULL);
+    repair.apply(chunk);
+    return true;
+}
+
+// Writes and empties 'output'; counted and timed if 'stats' is set.
+static bool writeOutput(OutputBuffer& output, int fd, StreamStats * stats)
+{
+    if (!stats)
+        return output.writeTo(fd);
+    output.visit([stats](string_view data) { stats->countOutput(data); });
+    PhaseTimer timer(&stats->writeTime);
+    return output.writeTo(fd);
+}
+
+/*
+ * Transforms the lines of a chunk; a chunk that does not end with the
+ * delimiter ends with a fragment of a line. The output of the lines preceding an error
+ * is kept. Unchanged lines of a stable chunk are referenced, not copied.
+ */
+static utf8proc_ssize_t transformChunk(string_view chunk, bool stable, const Transform& transform, char delimiter,
+                                       OutputBuffer& output)
+{
+    if (transform.wholeChunks)
+    {
+        string& data = output.data();
+        const size_t initialSize = data.size();
+        const utf8proc_ssize_t nb = transform.function(chunk.data(), chunk.size(), data);
+        if (nb >= 0)
+            return 0;
+        // Only the lines preceding the error are kept, as line by line.
+        const size_t newline = data.rfind(delimiter);
+        data.resize(newline == string::npos || newline < initialSize ? initialSize : newline + 1);
+        return nb;
+    }
+    size_t start = 0;
+    while (start < chunk.size())
+    {
+        const char * line = chunk.data() + start;
+        const char * newline = (const char*) memchr(line, delimiter, chunk.size() - start);
+        const size_t end = newline ? newline - chunk.data() : chunk.size();
+        if (transform.unchanged && transform.unchanged(line, end - start))
+        {
+            if (stable)
+            {
+                output.reference(line, end - start + (newline ? 1 : 0));
+            }
+            else
+            {
+                output.append(line, end - start);
+                if (newline)
+                    output.append(delimiter);
+            }
+            start = end + 1;
+            continue;
+        }
+        const utf8proc_ssize_t nb = transform.function(line, end - start, output.data());
+        if (nb < 0)
+            return nb;
+        if (newline)
+            output.append(delimiter);
+        start = end + 1;
+    }
+    return 0;
+}
+
+// A chunk handed to a worker thread; copied unless it is stable.
+struct ChunkJob
+{
+    string storage;
+    string_view input;
+    bool stable = false;
+    OutputBuffer output;
+    utf8proc_ssize_t status = 0;
+    bool done = false;
+    // Nanoseconds, when counting.
+    uint64_t transformTime = 0;
+};
+
+// Closes what it opened.
+struct ScopedFile
+{
+    int fd;
+    ~ScopedFile()
+    {
+        if (fd > 2)
+            close(fd);
+    }
+};
+
+static bool openInput(const StreamOptions& options, ScopedFile& in)
+{
+    if (options.input.empty())
+        return true;
+    in.fd = open(options.input.c_str(), O_RDONLY);
+    if (in.fd < 0)
+    {
+        cout << _("Cannot open ") << options.input << ": " << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
+
+static bool openFiles(const StreamOptions& options, ScopedFile& in, ScopedFile& out)
+{
+    if (!openInput(options, in))
+        return false;
+    if (!options.output.empty())
+    {
+        // Truncated once known to be distinct from the input.
+        out.fd = open(options.output.c_str(), O_WRONLY | O_CREAT, 0666);
+        if (out.fd < 0)
+        {
+            cout << _("Cannot open ") << options.output << ": " << strerror(errno) << endl;
+            return false;
+        }
+    }
+    struct stat inStatus, outStatus;
+    const bool inRegular = fstat(in.fd, &inStatus) == 0 && S_ISREG(inStatus.st_mode);
+    const bool outRegular = fstat(out.fd, &outStatus) == 0 && S_ISREG(outStatus.st_mode);
+    if (inRegular && outRegular && inStatus.st_dev == outStatus.st_dev && inStatus.st_ino == outStatus.st_ino)
+    {
+        cout << _("The input and the output must be different files.") << endl;
+        return false;
+    }
+    if (!options.output.empty() && outRegular && ftruncate(out.fd, 0) != 0)
+    {
+        cout << _("Cannot open ") << options.output << ": " << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
+
+static unique_ptr<ChunkReader> makeReader(const MappedFile& mapping, int fd, const StreamOptions& options)
+{
+    unique_ptr<ChunkReader> reader;
+    if (options.transcode)
+    {
+        // Decoded as it is read.
+        reader = make_unique<ChunkReader>(fd, STREAM_CHUNK_SIZE, options.delimiter);
+        reader->decode(options.from, options.repair == REPAIR_DROP);
+    }
+    else if (mapping.mapped())
+    {
+        reader = make_unique<ChunkReader>(mapping.data(), mapping.size(), STREAM_CHUNK_SIZE, options.delimiter);
+    }
+    else
+    {
+        reader = make_unique<ChunkReader>(fd, STREAM_CHUNK_SIZE, options.delimiter);
+    }
+    if (options.boundary)
+        reader->setBoundary(options.boundary);
+    return reader;
+}
+
+/*
+ * The encoder of the output of a transcoded stream, if not UTF-8 as it is.
+ * Tells on stderr what it could not encode, when it goes out of scope.
+ */
+struct StreamEncoder
+{
+    unique_ptr<TextEncoder> encoder;
+    explicit StreamEncoder(const StreamOptions& options)
+    {
+        if (options.transcode && (options.to.encoding != ENCODING_UTF8 || options.to.byteOrderMark))
+            encoder = make_unique<TextEncoder>(options.to);
+    }
+    ~StreamEncoder()
+    {
+        if (encoder && encoder->unrepresentable())
+            cerr << encoder->unrepresentable() << _(" characters not in Latin-1 were replaced with '?'.") << endl;
+    }
+};
+
+int streamLines(const function<bool(const char * data, size_t length)>& visitor, const StreamOptions& options)
+{
+    ScopedFile in = {0};
+    if (!openInput(options, in))
+        return 21;
+    MappedFile mapping(in.fd);
+    unique_ptr<ChunkReader> chunkReader = makeReader(mapping, in.fd, options);
+    ChunkRepair repair(options);
+    string_view chunk;
+    while (readChunk(*chunkReader, chunk, options.stats, repair))
+    {
+        PhaseTimer timer(options.stats ? &options.stats->transformTime : NULL);
+        size_t start = 0;
+        while (start < chunk.size())
+        {
+            const char * newline = (const char*) memchr(chunk.data() + start, options.delimiter, chunk.size() - start);
+            const size_t end = newline ? newline - chunk.data() : chunk.size();
+            if (!visitor(chunk.data() + start, end - start))
+                return 0;
+            start = end + 1;
+        }
+    }
+    if (chunkReader->error())
+    {
+        cout << _("Read error: ") << strerror(chunkReader->error()) << endl;
+        return 21;
+    }
+    return 0;
+}
+
+int streamLinePieces(const LineVisitor& visitor, const StreamOptions& options, const InputEndVisitor& inputEnd)
+{
+    ScopedFile in = {0};
+    ScopedFile out = {1};
+    if (!openFiles(options, in, out))
+        return 21;
+    MappedFile mapping(in.fd);
+    unique_ptr<ChunkReader> chunkReader = makeReader(mapping, in.fd, options);
+    StreamEncoder encoder(options);
+    OutputBuffer output(out.fd);
+    output.setEncoder(encoder.encoder.get());
+    ChunkRepair repair(options);
+    string_view chunk;
+    bool lineOpen = false;
+    utf8proc_ssize_t status = 0;
+    while (status == 0 && readChunk(*chunkReader, chunk, options.stats, repair))
+    {
+        {
+            PhaseTimer timer(options.stats ? &options.stats->transformTime : NULL);
+            size_t start = 0;
+            while (status == 0 && start < chunk.size())
+            {
+                const char * newline = (const char*) memchr(chunk.data() + start, options.delimiter, chunk.size() - start);
+                const size_t end = newline ? newline - chunk.data() : chunk.size();
+                status = visitor(chunk.data() + start, end - start, newline != NULL, output.data());
+                lineOpen = (newline == NULL);
+                start = end + 1;
+            }
+        }
+        if (output.full() && !writeOutput(output, out.fd, options.stats))
+        {
+            cout << _("Write error: ") << strerror(errno) << endl;
+            return 21;
+        }
+    }
+    if (status == 0 && lineOpen)
+        status = visitor(chunk.data() + chunk.size(), 0, true, output.data());
+    if (status == 0 && inputEnd)
+        status = inputEnd(output.data());
+    if (status < 0) // an error occured
+    {
+        writeOutput(output, out.fd, options.stats);
+        cout << utf8proc_errmsg(status) << endl;
+        return status * -1;
+    }
+    if (chunkReader->error())
+    {
+        writeOutput(output, out.fd, options.stats);
+        cout << _("Read error: ") << strerror(chunkReader->error()) << endl;
+        return 21;
+    }
+    if (!writeOutput(output, out.fd, options.stats))
+    {
+        cout << _("Write error: ") << strerror(errno) << endl;
+        return 21;
+    }
+    return 0;
+}
+
+int streamCodepoints(const CodepointVisitor& visitor, const StreamOptions& options)
+{
+    ScopedFile in = {0};
+    ScopedFile out = {1};
+    if (!openFiles(options, in, out))
+        return 21;
+    MappedFile mapping(in.fd);
+    unique_ptr<ChunkReader> chunkReader = makeReader(mapping, in.fd, options);
+    StreamEncoder encoder(options);
+    OutputBuffer output(out.fd);
+    output.setEncoder(encoder.encoder.get());
+    ChunkRepair repair(options);
+    string_view chunk;
+    while (readChunk(*chunkReader, chunk, options.stats, repair))
+    {
+        {
+            PhaseTimer timer(options.stats ? &options.stats->transformTime : NULL);
+            const utf8proc_uint8_t * data = (const utf8proc_uint8_t*) chunk.data();
+            size_t pos = 0;
+            while (pos < chunk.size())
+            {
+                utf8proc_int32_t codepoint = data[pos];
+                utf8proc_ssize_t nb = 1;
+                if (codepoint >= 0x80)
+                {
+                    nb = utf8proc_iterate(data + pos, chunk.size() - pos, &codepoint);
+                    if (nb < 0) // an error occured
+                    {
+                        writeOutput(output, out.fd, options.stats);
+                        cout << utf8proc_errmsg(nb) << endl;
+                        return nb * -1;
+                    }
+                }
+                visitor(codepoint, chunk.data() + pos, nb, output.data());
+                pos += nb;
+            }
+        }
+        if (output.full() && !writeOutput(output, out.fd, options.stats))
+        {
+            cout << _("Write error: ") << strerror(errno) << endl;
+            return 21;
+        }
+    }
+    if (chunkReader->error())
+    {
+        writeOutput(output, out.fd, options.stats);
+        cout << _("Read error: ") << strerror(chunkReader->error()) << endl;
+        return 21;
+    }
+    if (!writeOutput(output, out.fd, options.stats))
+    {
+        cout << _("Write error: ") << strerror(errno) << endl;
+        return 21;
+    }
+    return 0;
+}
+
+unsigned streamWorkers(const StreamOptions& options)
+{
+    return options.threads == 1 ? 1 : ThreadPool::effectiveThreads(options.threads);
+}
+
+int streamChunks(const ChunkVisitor& visitor, const StreamOptions& options)
+{
+    ScopedFile in = {0};
+    if (!openInput(options, in))
+        return 21;
+    MappedFile mapping(in.fd);
+    unique_ptr<ChunkReader> chunkReader = makeReader(mapping, in.fd, options);
+    ChunkReader& reader = *chunkReader;
+    ChunkRepair repair(options);
+    string_view chunk;
+    
+    if (options.threads == 1)
+    {
+        while (readChunk(reader, chunk, options.stats, repair))
+        {
+            PhaseTimer timer(options.stats ? &options.stats->transformTime : NULL);
+            visitor(chunk, 0);
+        }
+    }
+    else
+    {
+        // Chunks that are not stable are copied to buffers that the workers give back.
+        mutex buffersMutex;
+        condition_variable chunkDone;
+        vector<unique_ptr<string>> buffers;
+        vector<string*> spare;
+        size_t pending = 0;
+        {
+            ThreadPool pool(options.threads);
+            const size_t maxPending = 2 * pool.size();
+            while (readChunk(reader, chunk, options.stats, repair))
+            {
+                string * copy = NULL;
+                {
+                    unique_lock<mutex> lock(buffersMutex);
+                    chunkDone.wait(lock, [&] { return pending < maxPending; });
+                    pending++;
+                    if (!reader.stable() || repair.repaired())
+                    {
+                        if (spare.empty())
+                        {
+                            buffers.push_back(make_unique<string>());
+                            spare.push_back(buffers.back().get());
+                        }
+                        copy = spare.back();
+                        spare.pop_back();
+                    }
+                }
+                if (copy)
+                    copy->assign(chunk);
+                const string_view data = copy ? string_view(*copy) : chunk;
+                pool.submit([&, data, copy]() {
+                    const uint64_t start = options.stats ? monotonicNanoseconds() : 0;
+                    visitor(data, ThreadPool::worker());
+                    {
+                        lock_guard<mutex> lock(buffersMutex);
+                        if (options.stats)
+                            options.stats->transformTime += monotonicNanoseconds() - start;
+                        if (copy)
+                            spare.push_back(copy);
+                        pending--;
+                    }
+                    chunkDone.notify_all();
+                });
+            }
+            // The pool runs what is queued before its threads are joined.
+        }
+    }
+    if (reader.error())
+    {
+        cout << _("Read error: ") << strerror(reader.error()) << endl;
+        return 21;
+    }
+    return 0;
+}
+
+/*
+ * Transforms on the calling thread while the next chunks are read, and the
+ * previous ones written, on two more threads. Each job goes from the reader to
+ * the transform, to the writer and back to the reader; one of them is thus
+ * always at hand for each stage. 'status' and 'lastByte' are set as by the
+ * loop they replace; false on a write error, with 'writeError' set.
+ */
+static bool pipeTransform(ChunkReader& reader, ChunkRepair& repair, const Transform& transform,
+                          const StreamOptions& options, int fd, TextEncoder * encoder,
+                          utf8proc_ssize_t& status, char& lastByte, int& writeError)
+{
+    const unsigned JOBS = 3;
+    ChunkJob jobs[JOBS];
+    // A null job ends the stream.
+    SpscQueue<ChunkJob*, 4> transformQueue, writeQueue, freeQueue;
+    for (ChunkJob& job : jobs)
+    {
+        job.output.setEncoder(encoder);
+        freeQueue.push(&job);
+    }
+    // Stops reading after an error.
+    atomic<bool> stopping = false;
+    
+    thread readerThread([&]() {
+        string_view chunk;
+        while (!stopping.load(memory_order_relaxed) && readChunk(reader, chunk, options.stats, repair))
+        {
+            ChunkJob * job = freeQueue.pop();
+            // A repaired chunk is a copy too.
+            job->stable = reader.stable() && !repair.repaired();
+            if (job->stable)
+            {
+                job->input = chunk;
+            }
+            else
+            {
+                job->storage.assign(chunk);
+                job->input = job->storage;
+            }
+            transformQueue.push(job);
+        }
+        transformQueue.push(NULL);
+    });
+    
+    thread writerThread([&]() {
+        unique_ptr<UringWriter> uring = UringWriter::open(fd, JOBS);
+        vector<ChunkJob*> inFlight;
+        auto release = [&](ChunkJob * job) {
+            job->output.clear();
+            freeQueue.push(job);
+        };
+        // Hands back a job whose write is done, or all of them if the ring failed.
+        auto completed = [&](void * tag) {
+            if (!tag)
+            {
+                uring.reset();
+                for (ChunkJob * job : inFlight)
+                    release(job);
+                inFlight.clear();
+                return;
+            }
+            inFlight.erase(find(inFlight.begin(), inFlight.end(), tag));
+            release((ChunkJob*) tag);
+        };
+        auto fail = [&](int error) {
+            if (writeError == 0)
+                writeError = error;
+            stopping = true;
+        };
+        while (1)
+        {
+            ChunkJob * job = NULL;
+            if (uring && !uring->idle() && (uring->full() || !writeQueue.tryPop(job)))
+            {
+                // Nothing else to do until a write completes.
+                void * tag;
+                bool written;
+                {
+                    PhaseTimer timer(options.stats ? &options.stats->writeTime : NULL);
+                    written = uring->complete(tag);
+                }
+                if (!written)
+                    fail(errno);
+                completed(tag);
+                continue;
+            }
+            else if (!uring || uring->idle())
+            {
+                job = writeQueue.pop();
+            }
+            if (!job)
+                break;
+            if (writeError || job->output.size() == 0)
+            {
+                release(job);
+                continue;
+            }
+            if (!uring)
+            {
+                if (!writeOutput(job->output, fd, options.stats))
+                    fail(errno);
+                release(job);
+                continue;
+            }
+            if (options.stats)
+                job->output.visit([&options](string_view data) { options.stats->countOutput(data); });
+            PhaseTimer timer(options.stats ? &options.stats->writeTime : NULL);
+            if (uring->submit(job->output.gather(), job))
+            {
+                inFlight.push_back(job);
+            }
+            else
+            {
+                fail(errno);
+                release(job);
+            }
+        }
+        while (uring && !uring->idle())
+        {
+            void * tag;
+            PhaseTimer timer(options.stats ? &options.stats->writeTime : NULL);
+            if (!uring->complete(tag))
+                fail(errno);
+            completed(tag);
+        }
+    });
+    
+    while (ChunkJob * job = transformQueue.pop())
+    {
+        if (status == 0 && !stopping.load(memory_order_relaxed))
+        {
+            {
+                PhaseTimer timer(options.stats ? &options.stats->transformTime : NULL);
+                status = transformChunk(job->input, job->stable, transform, options.delimiter, job->output);
+            }
+            lastByte = job->input.back();
+            if (status < 0)
+                stopping = true;
+        }
+        writeQueue.push(job);
+    }
+    readerThread.join();
+    writeQueue.push(NULL);
+    writerThread.join();
+    return writeError == 0;
+}
+
+int streamTransform(const Transform& transform, const StreamOptions& options)
+{
+    ScopedFile in = {0};
+    ScopedFile out = {1};
+    if (!openFiles(options, in, out))
+        return 21;
+    
+    MappedFile mapping(in.fd);
+    unique_ptr<ChunkReader> chunkReader = makeReader(mapping, in.fd, options);
+    ChunkReader& reader = *chunkReader;
+    StreamEncoder encoder(options);
+    OutputBuffer output(out.fd);
+    output.setEncoder(encoder.encoder.get());
+    ChunkRepair repair(options);
+    string_view chunk;
+    char lastByte = options.delimiter;
+    utf8proc_ssize_t status = 0;
+    
+    if (options.threads == 1)
+    {
+        int writeError = 0;
+        if (!pipeTransform(reader, repair, transform, options, out.fd, encoder.encoder.get(), status, lastByte,
+                           writeError))
+        {
+            cout << _("Write error: ") << strerror(writeError) << endl;
+            return 21;
+        }
+    }
+    else
+    {
+        // Chunks are transformed concurrently and written in input order.
+        mutex jobsMutex;
+        condition_variable jobDone;
+        deque<unique_ptr<ChunkJob>> pending;
+        vector<unique_ptr<ChunkJob>> spare;
+        ThreadPool pool(options.threads);
+        const size_t maxPending = 2 * pool.size();
+        bool writeFailed = false;
+        
+        auto writeFront = [&]() {
+            unique_ptr<ChunkJob> job;
+            {
+                unique_lock<mutex> lock(jobsMutex);
+                jobDone.wait(lock, [&] { return pending.front()->done; });
+                job = std::move(pending.front());
+                pending.pop_front();
+            }
+            if (status == 0 && !writeFailed)
+            {
+                status = job->status;
+                writeFailed = !writeOutput(job->output, out.fd, options.stats);
+            }
+            if (options.stats)
+                options.stats->transformTime += job->transformTime;
+            job->output.clear();
+            spare.push_back(std::move(job));
+        };
+        
+        while (status == 0 && !writeFailed && readChunk(reader, chunk, options.stats, repair))
+        {
+            unique_ptr<ChunkJob> job;
+            if (spare.empty())
+            {
+                job = make_unique<ChunkJob>();
+            }
+            else
+            {
+                job = std::move(spare.back());
+                spare.pop_back();
+            }
+            // A repaired chunk is a copy too.
+            job->stable = reader.stable() && !repair.repaired();
+            if (job->stable)
+            {
+                job->input = chunk;
+            }
+            else
+            {
+                job->storage.assign(chunk);
+                job->input = job->storage;
+            }
+            job->output.setEncoder(encoder.encoder.get());
+            job->done = false;
+            job->transformTime = 0;
+            lastByte = chunk.back();
+            ChunkJob * task = job.get();
+            pending.push_back(std::move(job));
+            pool.submit([&, task]() {
+                {
+                    PhaseTimer timer(options.stats ? &task->transformTime : NULL);
+                    task->status = transformChunk(task->input, task->stable, transform, options.delimiter, task->output);
+                }
+                {
+                    lock_guard<mutex> lock(jobsMutex);
+                    task->done = true;
+                }
+                jobDone.notify_all();
+            });
+            if (pending.size() >= maxPending)
+                writeFront();
+        }
+        // Pending jobs reference this frame; wait for all of them.
+        while (!pending.empty())
+            writeFront();
+        if (writeFailed)
+        {
+            cout << _("Write error: ") << strerror(errno) << endl;
+            return 21;
+        }
+    }
+    
+    if (status < 0) // an error occured
+    {
+        writeOutput(output, out.fd, options.stats);
+        cout << utf8proc_errmsg(status) << endl;
+        return status * -1;
+    }
+    if (reader.error())
+    {
+        writeOutput(output, out.fd, options.stats);
+        cout << _("Read error: ") << strerror(reader.error()) << endl;
+        return 21;
+    }
+    // As in single line mode, the last line is always terminated.
+    if (transform.terminateLast && lastByte != options.delimiter)
+        output.append(options.delimiter);
+    if (!writeOutput(output, out.fd, options.stats))
+    {
+        cout << _("Write error: ") << strerror(errno) << endl;
+        return 21;
+    }
+
+    return 0;
+}
+
+/*
+ * The files of rewriteFiles(), each rewritten, or a directory walked, by a
+ * task of its pool.
+ */
+struct FileBatch
+{
+    const Transform& transform;
+    const StreamOptions& options;
+    WorkStealingPool& pool;
+    atomic<uint64_t> rewritten = 0;
+    atomic<uint64_t> unchanged = 0;
+    atomic<uint64_t> failed = 0;
+    // Serializes the messages of the tasks.
+    mutex reportMutex;
+
+    FileBatch(const Transform& transform, const StreamOptions& options, WorkStealingPool& pool)
+        : transform(transform), options(options), pool(pool)
+    {
+    }
+    void fail(const string& path, const char * message);
+    void rewrite(const string& path);
+    void walk(const string& path);
+};
+
+void FileBatch::fail(const string& path, const char * message)
+{
+    failed++;
+    lock_guard<mutex> lock(reportMutex);
+    cout << path << ": " << message << endl;
+}
+
+// Whether 'output' holds the same bytes as 'data'.
+static bool sameOutput(const OutputBuffer& output, string_view data)
+{
+    if (output.size() != data.size())
+        return false;
+    bool same = true;
+    size_t offset = 0;
+    output.visit([&](string_view piece) {
+        // An unchanged line is referenced where it is.
+        if (same && piece.data() != data.data() + offset)
+            same = memcmp(piece.data(), data.data() + offset, piece.size()) == 0;
+        offset += piece.size();
+    });
+    return same;
+}
+
+void FileBatch::rewrite(const string& path)
+{
+    ScopedFile in = {-1};
+    in.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (in.fd < 0 || fstat(in.fd, &status) != 0)
+        return fail(path, strerror(errno));
+    if (status.st_size == 0)
+    {
+        unchanged++;
+        return;
+    }
+    const MappedFile mapping(in.fd);
+    if (!mapping.mapped())
+        return fail(path, strerror(errno));
+    const string_view original(mapping.data(), mapping.size());
+    string_view input = original;
+    // Reused by the files of a thread, as the output.
+    static thread_local string repaired;
+    static thread_local vector<u7::InvalidSequence> invalid;
+    static thread_local OutputBuffer output;
+    if (options.repair != REPAIR_NONE)
+    {
+        const size_t valid = validUtf8Prefix(input.data(), input.size());
+        if (valid != input.size())
+        {
+            repaired.assign(input.data(), valid);
+            invalid.clear();
+            u7::RepairOptions repairOptions;
+            repairOptions.drop = (options.repair == REPAIR_DROP);
+            u7::repair(input.substr(valid), repairOptions, repaired, &invalid);
+            {
+                lock_guard<mutex> lock(reportMutex);
+                printInvalid(invalid, valid, "UTF-8", path);
+            }
+            input = repaired;
+        }
+    }
+    output.clear();
+    const utf8proc_ssize_t nb = transformChunk(input, true, transform, options.delimiter, output);
+    if (nb < 0)
+    {
+        output.clear();
+        return fail(path, utf8proc_errmsg(nb));
+    }
+    if (sameOutput(output, original))
+    {
+        output.clear();
+        unchanged++;
+        return;
+    }
+    
+    // Created next to the file, so that it can be renamed over it.
+    const size_t slash = path.rfind('/');
+    const size_t nameStart = (slash == string::npos) ? 0 : slash + 1;
+    string temporary = path.substr(0, nameStart) + "." + path.substr(nameStart) + ".XXXXXX";
+    ScopedFile out = {mkostemp(temporary.data(), O_CLOEXEC)};
+    if (out.fd < 0)
+    {
+        output.clear();
+        return fail(path, strerror(errno));
+    }
+    bool replaced = output.writeTo(out.fd) && fchmod(out.fd, status.st_mode & 07777) == 0;
+    // Only permitted to root; the file is then owned by whoever rewrites it.
+    if (replaced)
+        (void) !fchown(out.fd, status.st_uid, status.st_gid);
+    replaced = replaced && close(out.fd) == 0;
+    out.fd = -1;
+    replaced = replaced && rename(temporary.c_str(), path.c_str()) == 0;
+    if (!replaced)
+    {
+        const int error = errno;
+        output.clear();
+        unlink(temporary.c_str());
+        return fail(path, strerror(error));
+    }
+    rewritten++;
+}
+
+void FileBatch::walk(const string& path)
+{
+    DIR * dir = opendir(path.c_str());
+    if (!dir)
+        return fail(path, strerror(errno));
+    const string prefix = (path.back() == '/') ? path : path + '/';
+    /*
+     * The whole directory is listed before any of its files is rewritten, so
+     * that the temporary copies are never listed.
+     */
+    vector<pair<string, bool>> entries;
+    while (const dirent * entry = readdir(dir))
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        bool directory = (entry->d_type == DT_DIR);
+        bool regular = (entry->d_type == DT_REG);
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat status;
+            if (fstatat(dirfd(dir), entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                fail(prefix + entry->d_name, strerror(errno));
+                continue;
+            }
+            directory = S_ISDIR(status.st_mode);
+            regular = S_ISREG(status.st_mode);
+        }
+        // Symbolic links and special files are skipped.
+        if (directory || regular)
+            entries.emplace_back(prefix + entry->d_name, directory);
+    }
+    closedir(dir);
+    for (pair<string, bool>& entry : entries)
+    {
+        pool.submit([this, path = std::move(entry.first), directory = entry.second]() {
+            if (directory)
+                walk(path);
+            else
+                rewrite(path);
+        });
+    }
+}
+
+int rewriteFiles(const vector<string>& paths, bool recursive, const Transform& transform, const StreamOptions& options)
+{
+    WorkStealingPool pool(options.threads);
+    FileBatch batch(transform, options, pool);
+    for (const string& path : paths)
+    {
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+        {
+            batch.fail(path, strerror(errno));
+            continue;
+        }
+        if (S_ISDIR(status.st_mode))
+        {
+            if (!recursive)
+            {
+                batch.fail(path, strerror(EISDIR));
+                continue;
+            }
+            pool.submit([&batch, path]() { batch.walk(path); });
+        }
+        else if (S_ISREG(status.st_mode))
+        {
+            // The target of a symbolic link is rewritten, not the link replaced.
+            string target = path;
+            struct stat linkStatus;
+            if (lstat(path.c_str(), &linkStatus) == 0 && S_ISLNK(linkStatus.st_mode))
+            {
+                char * resolved = realpath(path.c_str(), NULL);
+                if (!resolved)
+                {
+                    batch.fail(path, strerror(errno));
+                    continue;
+                }
+                target = resolved;
+                free(resolved);
+            }
+            pool.submit([&batch, target]() { batch.rewrite(target); });
+        }
+        else
+        {
+            batch.fail(path, _("Not a regular file"));
+        }
+    }
+    // The tasks reference this frame.
+    pool.wait();
+    cerr << batch.rewritten << _(" files rewritten, ") << batch.unchanged << _(" unchanged, ") << batch.failed
+         << _(" failed") << endl;
+    return batch.failed ? 21 : 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * File:   Stream.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <sys/uio.h>
+#include <utf8proc.h>
+#include "Encoding.h"
+
+// Bytes requested from the input at once, and output bytes accumulated before a write.
+#define STREAM_CHUNK_SIZE (1 << 20)
+
+struct StreamStats;
+
+/*
+ * Transforms a fragment of a line and appends the result to 'output'.
+ * Returns 0 or a negative utf8proc error code.
+ */
+typedef std::function<utf8proc_ssize_t(const char * data, size_t length, std::string& output)> TransformFunction;
+
+/*
+ * A read-only, private mapping of a whole file.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(int fd);
+    ~MappedFile();
+    // False for pipes, terminals and empty files, which must be read instead.
+    bool mapped() const { return m_data != NULL; }
+    const char * data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char * m_data = NULL;
+    size_t m_size = 0;
+};
+
+/*
+ * Reads a file descriptor, or walks a mapping, in fixed-size chunks. Each
+ * chunk ends after a delimiter, a newline by default, or before a stable
+ * starter so that it can be processed on its own; what follows the cut is
+ * carried over to the next chunk.
+ */
+class ChunkReader
+{
+public:
+    ChunkReader(int fd, size_t chunkSize = STREAM_CHUNK_SIZE, char delimiter = '\n');
+    ChunkReader(const char * data, size_t length, size_t chunkSize = STREAM_CHUNK_SIZE, char delimiter = '\n');
+    /*
+     * Decodes what is read from the file descriptor to UTF-8; ill-formed input
+     * is replaced with U+FFFD, or dropped, and its offsets printed on stderr.
+     */
+    void decode(const TextEncoding& encoding, bool drop);
+    // Codepoints before which a chunk without a delimiter may be cut; isStableStarter() by default.
+    void setBoundary(std::function<bool(utf8proc_int32_t codepoint)> boundary) { m_boundary = std::move(boundary); }
+    // Returns false at the end of the input or on error.
+    bool next(std::string_view& chunk);
+    // Chunks of a mapping remain valid as long as the mapping; otherwise, until the next call.
+    bool stable() const { return m_fd < 0; }
+    // errno of a failed read, 0 otherwise.
+    int error() const { return m_error; }
+
+private:
+    int m_fd;
+    size_t m_chunkSize;
+    char m_delimiter;
+    std::function<bool(utf8proc_int32_t codepoint)> m_boundary;
+    std::string m_buffer;
+    const char * m_data;
+    size_t m_start = 0;
+    size_t m_end = 0;
+    bool m_eof = false;
+    int m_error = 0;
+    // Input not decoded yet, when decoding.
+    std::unique_ptr<TextDecoder> m_decoder;
+    Encoding m_encoding = ENCODING_UTF8;
+    std::string m_raw;
+    size_t m_rawEnd = 0;
+    std::vector<u7::InvalidSequence> m_invalid;
+
+    bool fill();
+    bool readDecoded();
+};
+
+/*
+ * Accumulates output as owned bytes and as references to unchanged input, and
+ * writes it to a file descriptor in large vectored writes.
+ */
+class OutputBuffer
+{
+public:
+    OutputBuffer(int fd = -1, size_t capacity = STREAM_CHUNK_SIZE);
+    ~OutputBuffer();
+    // Owned bytes; append freely.
+    std::string& data() { return m_data; }
+    void append(const char * data, size_t length) { m_data.append(data, length); }
+    void append(char c) { m_data.push_back(c); }
+    // Emits 'length' bytes at 'data' without copying; they must outlive the next flush.
+    void reference(const char * data, size_t length);
+    size_t size() const { return m_referenced + m_data.size(); }
+    bool full() const { return size() >= m_capacity; }
+    // Writes when the capacity is exceeded.
+    bool flushIfFull() { return !full() || flush(); }
+    bool flush() { return writeTo(m_fd); }
+    // Writes and empties the buffer.
+    bool writeTo(int fd);
+    // Passes what writeTo() would write, in order, without emptying the buffer.
+    void visit(const std::function<void(std::string_view data)>& visitor) const;
+    /*
+     * What writeTo() would write, encoded if an encoder is set, for writing
+     * elsewhere; valid until the buffer is cleared or changed.
+     */
+    std::vector<iovec>& gather();
+    void clear();
+    // Encodes what is written from UTF-8, if set; it is then used by writeTo() and gather() only.
+    void setEncoder(TextEncoder * encoder) { m_encoder = encoder; }
+
+private:
+    // A run of owned bytes has a null 'reference'.
+    struct Segment
+    {
+        const char * reference;
+        size_t offset;
+        size_t length;
+    };
+    int m_fd;
+    size_t m_capacity;
+    std::string m_data;
+    std::vector<Segment> m_segments;
+    // Owned bytes before this offset are in 'm_segments'.
+    size_t m_segmented = 0;
+    size_t m_referenced = 0;
+    TextEncoder * m_encoder = NULL;
+    std::string m_encoded;
+    std::vector<iovec> m_vectors;
+};
+
+/*
+ * What a stream applies to each line.
+ */
+struct Transform
+{
+    TransformFunction function;
+    // Optional; true for a line that 'function' would leave unchanged.
+    std::function<bool(const char * data, size_t length)> unchanged;
+    // 'function' maps the delimiter to itself and is passed whole chunks, several lines at once.
+    bool wholeChunks = false;
+    // The last line is terminated by the delimiter, even if it is not in the input.
+    bool terminateLast = true;
+};
+
+// What a stream does with ill-formed UTF-8.
+enum InputRepair {REPAIR_NONE, REPAIR_REPLACE, REPAIR_DROP};
+
+struct StreamOptions
+{
+    // 0 means one thread per core.
+    unsigned threads = 1;
+    // Files to read and to write; stdin and stdout if empty.
+    std::string input;
+    std::string output;
+    // Ends the lines of the input and of the output; NUL for records that may hold newlines.
+    char delimiter = '\n';
+    /*
+     * Codepoints before which a line longer than a chunk may be cut, the
+     * pieces being transformed apart with the same result; stable starters if
+     * not set, which suits unaccent but not compatibility mappings.
+     */
+    std::function<bool(utf8proc_int32_t codepoint)> boundary;
+    // Counted and timed if set; null by default, at no cost.
+    StreamStats * stats = NULL;
+    /*
+     * Unless REPAIR_NONE, ill-formed UTF-8 is replaced with U+FFFD or dropped
+     * as it is read, and its offsets in the input are printed on stderr.
+     */
+    InputRepair repair = REPAIR_NONE;
+    /*
+     * If set, the input is decoded from 'from' and the output encoded to 'to';
+     * the stream is UTF-8 in between. Ill-formed input is then always repaired,
+     * replaced unless REPAIR_DROP.
+     */
+    bool transcode = false;
+    TextEncoding from;
+    TextEncoding to;
+};
+
+/*
+ * Replaces or drops the ill-formed UTF-8 of a whole input, as a stream would,
+ * and tells where it was on stderr.
+ */
+void repairInput(std::string& input, InputRepair repair);
+
+/*
+ * Applies a transform to every line of the input, in constant memory.
+ * Lines longer than a chunk are transformed piecewise, cut before a codepoint
+ * that 'options.boundary' accepts.
+ * Each line of the result is terminated by the delimiter.
+ * An input file is mapped when possible, and unchanged lines are then written
+ * from the mapping.
+ * On a single thread, the input is read and the output written on two more
+ * threads, as the chunks in between are transformed. Built with U7_IO_URING,
+ * an output file is written with io_uring, several chunks at once.
+ * With more than one thread, chunks are transformed on a pool of workers and
+ * the output is identical. The transform function must then be safe to call
+ * concurrently.
+ * Returns 0, the absolute value of a utf8proc error code, or 21 on I/O error.
+ */
+int streamTransform(const Transform& transform, const StreamOptions& options);
+
+/*
+ * Applies a transform to every line of each file of 'paths', and of every
+ * regular file below the directories of 'paths' if 'recursive', in place. The
+ * files are processed concurrently on a work-stealing pool of
+ * 'options.threads' threads, as the directories are walked; symbolic links
+ * found there are not followed.
+ * A file is replaced atomically by a renamed temporary copy, with the same
+ * mode, only if the transform changes it; the others are not written to. The
+ * last line is not terminated if it was not.
+ * Errors are printed per file, and a summary on stderr.
+ * Returns 0, or 21 if a file could not be read, transformed or replaced.
+ */
+int rewriteFiles(const std::vector<std::string>& paths, bool recursive, const Transform& transform,
+                 const StreamOptions& options);
+
+/*
+ * Passes every line of the input, or fragments of lines cut at stable starters,
+ * to 'visitor' until it returns false.
+ * Returns 0, or 21 on I/O error.
+ */
+int streamLines(const std::function<bool(const char * data, size_t length)>& visitor, const StreamOptions& options);
+
+/*
+ * Receives a chunk of the input, made of whole lines or cut at a stable starter,
+ * and the index of the worker thread visiting it, below streamWorkers().
+ */
+typedef std::function<void(std::string_view chunk, unsigned worker)> ChunkVisitor;
+
+/*
+ * Passes every chunk of the input to 'visitor', on a pool of workers with more
+ * than one thread, in no particular order; the visitor must then be safe to
+ * call concurrently, on a different worker index.
+ * Returns 0, or 21 on I/O error.
+ */
+int streamChunks(const ChunkVisitor& visitor, const StreamOptions& options);
+
+// Number of workers that streamChunks() runs for these options.
+unsigned streamWorkers(const StreamOptions& options);
+
+/*
+ * Receives a piece of a line, holding whole codepoints, and whether it ends
+ * the line; appends to 'output'.
+ * Returns 0 or a negative utf8proc error code.
+ */
+typedef std::function<utf8proc_ssize_t(const char * data, size_t length, bool lineEnd, std::string& output)> LineVisitor;
+// Appends what is left at the end of the input; returns 0 or a negative utf8proc error code.
+typedef std::function<utf8proc_ssize_t(std::string& output)> InputEndVisitor;
+
+/*
+ * Passes every line of the input to 'visitor', without its delimiter, in
+ * pieces cut at stable starters when it is longer than a chunk, and writes
+ * what it appends. A last line without a delimiter is ended by an empty piece.
+ * Then 'inputEnd', if any, is called.
+ * Returns 0, the absolute value of a utf8proc error code, or 21 on I/O error.
+ */
+int streamLinePieces(const LineVisitor& visitor, const StreamOptions& options,
+                     const InputEndVisitor& inputEnd = InputEndVisitor());
+
+/*
+ * Receives each codepoint of the input, with its bytes, and appends to 'output'.
+ */
+typedef std::function<void(utf8proc_int32_t codepoint, const char * bytes, size_t length, std::string& output)> CodepointVisitor;
+
+/*
+ * Passes every codepoint of the input to 'visitor' and writes what it appends.
+ * Returns 0, the absolute value of a utf8proc error code on invalid input, or
+ * 21 on I/O error.
+ */
+int streamCodepoints(const CodepointVisitor& visitor, const StreamOptions& options);
+
+#endif // STREAM_H
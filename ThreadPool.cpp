@@ -0,0 +1,177 @@
+/*
+ * File:   ThreadPool.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+static thread_local unsigned workerIndex = 0;
+// The pool of the calling thread, if a WorkStealingPool.
+static thread_local const void * stealingPool = NULL;
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    threads = effectiveThreads(threads);
+    for (unsigned i = 0; i < threads; i++)
+        m_threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (thread& t : m_threads)
+        t.join();
+}
+
+unsigned ThreadPool::effectiveThreads(unsigned requested)
+{
+    if (requested > 0)
+        return requested;
+    const unsigned cores = thread::hardware_concurrency();
+    return cores ? cores : 1;
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+unsigned ThreadPool::worker()
+{
+    return workerIndex;
+}
+
+void ThreadPool::work(unsigned index)
+{
+    workerIndex = index;
+    while (1)
+    {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+{
+    threads = ThreadPool::effectiveThreads(threads);
+    for (unsigned i = 0; i < threads; i++)
+        m_queues.push_back(make_unique<Queue>());
+    for (unsigned i = 0; i < threads; i++)
+        m_threads.emplace_back(&WorkStealingPool::work, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queuedCondition.notify_all();
+    for (thread& t : m_threads)
+        t.join();
+}
+
+void WorkStealingPool::submit(function<void()> task)
+{
+    unsigned index;
+    if (stealingPool == this)
+    {
+        index = workerIndex;
+    }
+    else
+    {
+        lock_guard<mutex> lock(m_mutex);
+        index = m_next++ % m_queues.size();
+    }
+    {
+        // Counted before it can be taken; a deque is always locked first.
+        Queue& queue = *m_queues[index];
+        lock_guard<mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        lock_guard<mutex> countLock(m_mutex);
+        m_queued++;
+        m_unfinished++;
+    }
+    m_queuedCondition.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    unique_lock<mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_unfinished == 0; });
+}
+
+// The newest task of its own deque, or the oldest of another one.
+bool WorkStealingPool::take(unsigned index, function<void()>& task)
+{
+    for (unsigned i = 0; i < m_queues.size(); i++)
+    {
+        Queue& queue = *m_queues[(index + i) % m_queues.size()];
+        lock_guard<mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        if (i == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        lock_guard<mutex> countLock(m_mutex);
+        m_queued--;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(unsigned index)
+{
+    workerIndex = index;
+    stealingPool = this;
+    while (1)
+    {
+        function<void()> task;
+        if (!take(index, task))
+        {
+            unique_lock<mutex> lock(m_mutex);
+            // A task that is running may still submit more.
+            m_queuedCondition.wait(lock, [this] { return m_queued > 0 || (m_stopping && m_unfinished == 0); });
+            if (m_queued == 0)
+                return;
+            continue;
+        }
+        task();
+        task = nullptr;
+        lock_guard<mutex> lock(m_mutex);
+        if (--m_unfinished == 0)
+        {
+            m_doneCondition.notify_all();
+            m_queuedCondition.notify_all();
+        }
+    }
+}
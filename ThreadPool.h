@@ -0,0 +1,89 @@
+/*
+ * File:   ThreadPool.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+/*
+ * A fixed number of threads running queued tasks in submission order.
+ * Tasks still queued at destruction are run before the threads are joined.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+    void submit(std::function<void()> task);
+    unsigned size() const { return m_threads.size(); }
+    // Index of the calling thread in its pool, from 0; 0 outside any pool.
+    static unsigned worker();
+    // 0 means one thread per core.
+    static unsigned effectiveThreads(unsigned requested);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+
+    void work(unsigned index);
+};
+
+/*
+ * A fixed number of threads, each running the tasks of its own deque, the
+ * newest first, and taking the oldest task of another deque when its own is
+ * empty. A task submitted by a task goes to the deque of its thread. Suits
+ * tasks of uneven cost that are found as the work proceeds, such as walking
+ * directories.
+ * All tasks, including those submitted meanwhile, are run before the threads
+ * are joined at destruction.
+ */
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned threads);
+    ~WorkStealingPool();
+    void submit(std::function<void()> task);
+    // Returns when no task is queued or running; not from a task.
+    void wait();
+    unsigned size() const { return m_threads.size(); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    // Guards the counts, which idle threads and wait() sleep on.
+    std::mutex m_mutex;
+    std::condition_variable m_queuedCondition;
+    std::condition_variable m_doneCondition;
+    size_t m_queued = 0;
+    // Queued or running.
+    size_t m_unfinished = 0;
+    bool m_stopping = false;
+    // Deque of the next task submitted from outside the pool.
+    unsigned m_next = 0;
+
+    bool take(unsigned index, std::function<void()>& task);
+    void work(unsigned index);
+};
+
+#endif // THREADPOOL_H
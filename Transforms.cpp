@@ -0,0 +1,600 @@
+/*
+ * File:   Transforms.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Transforms.h"
+#include "Ascii.h"
+#include "QuickCheck.h"
+#include "UnaccentTable.h"
+#include <vector>
+#include <array>
+#include <utility>
+
+using namespace std;
+
+// Shorter runs of printable ASCII characters are left within the mapped spans.
+#define ASCII_RUN_MIN 8
+// Codepoints; enough for most lines.
+#define SCRATCH_INITIAL_SIZE 4096
+
+bool isStableStarter(utf8proc_int32_t codepoint)
+{
+    if (codepoint < 0x80) // Control characters may be stripped, or merged as CR LF.
+        return isPrintableAscii(codepoint);
+    // Conjoining jamos compose with each other.
+    if ((codepoint >= 0x1100 && codepoint < 0x1200) || (codepoint >= 0xD7B0 && codepoint < 0xD800))
+        return false;
+    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
+    if (property->combining_class != 0 || property->ignorable)
+        return false;
+    switch (property->category)
+    {
+        // Marks with a null combining class may still be the second character of a composition.
+        case UTF8PROC_CATEGORY_MN:
+        case UTF8PROC_CATEGORY_MC:
+        case UTF8PROC_CATEGORY_ME:
+        // Stripped by the unaccent options, which would bring the neighbours together.
+        case UTF8PROC_CATEGORY_CN:
+        case UTF8PROC_CATEGORY_CC:
+        case UTF8PROC_CATEGORY_CF:
+        case UTF8PROC_CATEGORY_CS:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool mapsToStarter(utf8proc_int32_t codepoint, int options)
+{
+    if (codepoint < 0x80)
+        return isStableStarter(codepoint);
+    utf8proc_int32_t mapped[32];
+    int boundClass = 0;
+    const utf8proc_ssize_t nb = utf8proc_decompose_char(codepoint, mapped, 32,
+                                                        utf8proc_option_t (options & ~UTF8PROC_NULLTERM), &boundClass);
+    if (nb <= 0 || nb > 32)
+        return false;
+    const utf8proc_int32_t first = mapped[0];
+    // Leading jamos compose with what follows only.
+    if ((first >= 0x1100 && first < 0x1160) || (first >= 0xA960 && first < 0xA980))
+        return true;
+    return isStableStarter(first);
+}
+
+size_t lastBoundary(const char * data, size_t length, const function<bool(utf8proc_int32_t codepoint)>& boundary)
+{
+    for (size_t pos = length; pos-- > 1;)
+    {
+        const unsigned char byte = data[pos];
+        if (byte < 0x80)
+        {
+            if (boundary(byte))
+                return pos;
+            continue;
+        }
+        if ((byte & 0xC0) == 0x80) // Continuation byte.
+            continue;
+        utf8proc_int32_t codepoint;
+        if (utf8proc_iterate((const utf8proc_uint8_t*) data + pos, length - pos, &codepoint) > 0
+            && boundary(codepoint))
+            return pos;
+    }
+    return 0;
+}
+
+size_t lastCodepointBoundary(const char * data, size_t length)
+{
+    size_t pos = length;
+    while (pos > 0 && length - pos < 3 && (data[pos - 1] & 0xC0) == 0x80)
+        pos--;
+    if (pos == 0)
+        return length;
+    const unsigned char lead = data[pos - 1];
+    const size_t expected = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return (length - (pos - 1) >= expected) ? length : pos - 1;
+}
+
+int normalizationOptions(const string& type)
+{
+    if (type == "NFC")
+        return UTF8PROC_STABLE | UTF8PROC_COMPOSE;
+    if (type == "NFD")
+        return UTF8PROC_STABLE | UTF8PROC_DECOMPOSE;
+    if (type == "NFKC")
+        return UTF8PROC_STABLE | UTF8PROC_COMPOSE | UTF8PROC_COMPAT;
+    if (type == "NFKD")
+        return UTF8PROC_STABLE | UTF8PROC_DECOMPOSE | UTF8PROC_COMPAT;
+    if (type == "NFKC_Casefold")
+        return UTF8PROC_STABLE | UTF8PROC_COMPOSE | UTF8PROC_COMPAT | UTF8PROC_CASEFOLD | UTF8PROC_IGNORE;
+    return -1;
+}
+
+/*
+ * Per-thread scratch of mapFragment(), in codepoints. It grows to the longest
+ * fragment met and is then reused, so that mapping does not allocate.
+ */
+static vector<utf8proc_int32_t>& scratchBuffer()
+{
+    static thread_local vector<utf8proc_int32_t> scratch(SCRATCH_INITIAL_SIZE);
+    return scratch;
+}
+
+static inline bool isMark(const utf8proc_property_t * property)
+{
+    return property->category == UTF8PROC_CATEGORY_MN || property->category == UTF8PROC_CATEGORY_MC
+           || property->category == UTF8PROC_CATEGORY_ME;
+}
+
+/*
+ * utf8proc strips marks before folding the case, while U+0345 folds to a
+ * letter that NFKC_Casefold followed by unaccent keeps: such marks are folded
+ * first, by mapFragment() as a custom function.
+ */
+static utf8proc_int32_t foldMark(utf8proc_int32_t codepoint, void *)
+{
+    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
+    if (property->casefold_seqindex == UINT16_MAX || !isMark(property))
+        return codepoint;
+    utf8proc_int32_t folded[4];
+    int boundClass = 0;
+    if (utf8proc_decompose_char(codepoint, folded, 4, UTF8PROC_CASEFOLD, &boundClass) != 1)
+        return codepoint;
+    return folded[0];
+}
+
+utf8proc_ssize_t mapFragment(const char * data, size_t length, string& output, int options)
+{
+    // Same steps as utf8proc_map(), without its allocations.
+    const utf8proc_option_t mapOptions = utf8proc_option_t (options & ~UTF8PROC_NULLTERM);
+    const utf8proc_custom_func custom = ((options & UTF8PROC_CASEFOLD) && (options & UTF8PROC_STRIPMARK)) ? foldMark : NULL;
+    vector<utf8proc_int32_t>& scratch = scratchBuffer();
+    if (scratch.size() <= length)
+        scratch.resize(length + 1);
+    // One codepoint is kept for the NULL byte that utf8proc_reencode() appends.
+    utf8proc_ssize_t nb = utf8proc_decompose_custom((const utf8proc_uint8_t *) data, length,
+                                                    scratch.data(), scratch.size() - 1, mapOptions, custom, NULL);
+    if (nb >= (utf8proc_ssize_t) scratch.size()) // The decomposition is longer than the input.
+    {
+        scratch.resize(nb + 1);
+        nb = utf8proc_decompose_custom((const utf8proc_uint8_t *) data, length,
+                                       scratch.data(), scratch.size() - 1, mapOptions, custom, NULL);
+    }
+    if (nb < 0)
+        return nb;
+    nb = utf8proc_reencode(scratch.data(), nb, mapOptions);
+    if (nb < 0)
+        return nb;
+    output.append((const char*) scratch.data(), nb);
+    return nb;
+}
+
+/*
+ * Whether utf8proc outputs nothing for 'codepoint' with 'Options', whatever
+ * surrounds it: it is dropped before being decomposed or composed.
+ */
+template <int Options>
+static inline bool isDropped(utf8proc_int32_t codepoint)
+{
+    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
+    if constexpr ((Options & UTF8PROC_IGNORE) != 0)
+    {
+        if (property->ignorable)
+            return true;
+    }
+    if constexpr ((Options & UTF8PROC_STRIPNA) != 0)
+    {
+        if (property->category == UTF8PROC_CATEGORY_CN)
+            return true;
+    }
+    if constexpr ((Options & UTF8PROC_STRIPMARK) != 0)
+    {
+        // A mark with a case folding is folded by mapFragment() instead.
+        if (isMark(property) && ((Options & UTF8PROC_CASEFOLD) == 0 || property->casefold_seqindex == UINT16_MAX))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * ASCII characters that no option alters but case folding, and before which
+ * a span can end: the printable ones, and the control characters unless they
+ * are stripped.
+ */
+template <int Options>
+static inline size_t inertAsciiPrefix(const char * data, size_t length)
+{
+    if constexpr ((Options & UTF8PROC_STRIPCC) != 0)
+        return printableAsciiPrefix(data, length);
+    else
+        return asciiPrefix(data, length);
+}
+
+template <int Options>
+static inline bool isInertAscii(unsigned char byte)
+{
+    if constexpr ((Options & UTF8PROC_STRIPCC) != 0)
+        return isPrintableAscii(byte);
+    else
+        return byte < 0x80;
+}
+
+/*
+ * Maps a span of unaccentFragment. A BMP stable starter followed by another
+ * one is taken from the table; the rest is mapped by utf8proc in segments that
+ * start and end at stable starters. Codepoints that the options drop are
+ * skipped after a starter taken from the table.
+ */
+template <int Options>
+static utf8proc_ssize_t unaccentSpan(const char * data, size_t length, string& output)
+{
+    constexpr bool compat = (Options & UTF8PROC_COMPAT) != 0;
+    constexpr bool drops = (Options & (UTF8PROC_IGNORE | UTF8PROC_STRIPNA | UTF8PROC_STRIPMARK)) != 0;
+    static const UnaccentTable& table = UnaccentTable::forOptions(Options);
+    const size_t initialSize = output.size();
+    utf8proc_int32_t codepoint;
+    utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t*) data, length, &codepoint);
+    if (nb < 0)
+        return nb;
+    size_t entryLength = 0;
+    const char * entry = table.entry(codepoint, entryLength);
+    // Start of the bytes left to utf8proc.
+    size_t pending = 0;
+    size_t pos = 0;
+    while (pos < length)
+    {
+        size_t next = pos + nb;
+        size_t nextEntryLength = 0;
+        const char * nextEntry = NULL;
+        bool nextStable = true;
+        if (next < length)
+        {
+            nb = utf8proc_iterate((const utf8proc_uint8_t*) data + next, length - next, &codepoint);
+            if (nb < 0)
+                break;
+            nextEntry = table.entry(codepoint, nextEntryLength);
+            if constexpr (drops)
+            {
+                // A codepoint with an entry is a stable starter, which none of the options drops.
+                while (entry && !nextEntry && isDropped<Options>(codepoint))
+                {
+                    next += nb;
+                    if (next == length)
+                        break;
+                    nb = utf8proc_iterate((const utf8proc_uint8_t*) data + next, length - next, &codepoint);
+                    if (nb < 0)
+                        break;
+                    nextEntry = table.entry(codepoint, nextEntryLength);
+                }
+                if (nb < 0)
+                    break;
+            }
+            // A compatibility mapping may not be a stable starter; only the entries are vouched for.
+            if (next < length)
+                nextStable = nextEntry || (!compat && isStableStarter(codepoint));
+        }
+        if (entry && nextStable)
+        {
+            if (pending < pos)
+            {
+                const utf8proc_ssize_t mapped = mapFragment(data + pending, pos - pending, output, Options);
+                if (mapped < 0)
+                {
+                    output.resize(initialSize);
+                    return mapped;
+                }
+            }
+            output.append(entry, entryLength);
+            pending = next;
+        }
+        pos = next;
+        entry = nextEntry;
+        entryLength = nextEntryLength;
+    }
+    if (pending < length)
+    {
+        // Nothing of the span is output on error, as with a single mapping.
+        const utf8proc_ssize_t mapped = mapFragment(data + pending, length - pending, output, Options);
+        if (mapped < 0)
+        {
+            output.resize(initialSize);
+            return mapped;
+        }
+    }
+    return 0;
+}
+
+// Appends inert ASCII characters, lowercased if the options fold the case.
+template <int Options>
+static inline void appendAsciiRun(const char * data, size_t length, string& output)
+{
+    if constexpr ((Options & UTF8PROC_CASEFOLD) != 0)
+        appendAsciiCase(data, length, false, output);
+    else
+        output.append(data, length);
+}
+
+template <int Options>
+static utf8proc_ssize_t unaccentFragment(const char * data, size_t length, string& output)
+{
+    const size_t initialSize = output.size();
+    size_t pos = 0;
+    while (pos < length)
+    {
+        const size_t run = inertAsciiPrefix<Options>(data + pos, length - pos);
+        if (pos + run == length)
+        {
+            appendAsciiRun<Options>(data + pos, run, output);
+            break;
+        }
+        // The last character of the run may combine with what follows.
+        size_t spanStart = pos + run;
+        if (run > 0)
+        {
+            appendAsciiRun<Options>(data + pos, run - 1, output);
+            spanStart--;
+        }
+        // Inert ASCII characters are stable starters: the span can end before any of them.
+        size_t spanEnd = pos + run;
+        while (1)
+        {
+            while (spanEnd < length && !isInertAscii<Options>((unsigned char) data[spanEnd]))
+                spanEnd++;
+            if (spanEnd == length)
+                break;
+            const size_t next = inertAsciiPrefix<Options>(data + spanEnd, length - spanEnd);
+            if (next >= ASCII_RUN_MIN || spanEnd + next == length)
+                break;
+            spanEnd += next;
+        }
+        const utf8proc_ssize_t nb = unaccentSpan<Options>(data + spanStart, spanEnd - spanStart, output);
+        if (nb < 0)
+            return nb;
+        pos = spanEnd;
+    }
+    return output.size() - initialSize;
+}
+
+// The options of combination 'index' of UnaccentKernels, in the order of the fields.
+static constexpr u7::UnaccentOptions unaccentCombination(unsigned index)
+{
+    u7::UnaccentOptions options;
+    options.keepIgnorable = index & 1;
+    options.keepControl = index & 2;
+    options.keepMarks = index & 4;
+    options.keepUnassigned = index & 8;
+    options.recompose = index & 16;
+    return options;
+}
+
+template <unsigned... Index>
+static constexpr array<FragmentFunction, sizeof...(Index)> unaccentKernels(integer_sequence<unsigned, Index...>)
+{
+    return {{&unaccentFragment<unaccentFlags(unaccentCombination(Index))>...}};
+}
+
+// One per combination of the 5 flags of u7::UnaccentOptions.
+static constexpr array<FragmentFunction, 32> UnaccentKernels = unaccentKernels(make_integer_sequence<unsigned, 32>());
+
+FragmentFunction unaccentKernel(const u7::UnaccentOptions& options)
+{
+    return UnaccentKernels[options.keepIgnorable | options.keepControl << 1 | options.keepMarks << 2
+                           | options.keepUnassigned << 3 | options.recompose << 4];
+}
+
+utf8proc_ssize_t searchKeyFragment(const char * data, size_t length, string& output)
+{
+    return unaccentFragment<SEARCHKEY_OPTIONS>(data, length, output);
+}
+
+utf8proc_ssize_t normalizeFragment(const char * data, size_t length, string& output, int options,
+                                   const QuickCheck& quickCheck)
+{
+    const size_t initialSize = output.size();
+    size_t pos = 0;
+    while (pos < length)
+    {
+        const size_t run = quickCheck.stablePrefix(data + pos, length - pos);
+        if (pos + run == length)
+        {
+            output.append(data + pos, run);
+            break;
+        }
+        // The last codepoint of the run may combine with what follows.
+        size_t spanStart = pos + run;
+        if (run > 0)
+        {
+            do
+                spanStart--;
+            while (spanStart > pos && ((unsigned char) data[spanStart] & 0xC0) == 0x80);
+            output.append(data + pos, spanStart - pos);
+        }
+        // The span ends before the next codepoint that passes the quick check.
+        size_t spanEnd = pos + run;
+        do
+        {
+            utf8proc_int32_t codepoint;
+            const utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t*) data + spanEnd, length - spanEnd, &codepoint);
+            spanEnd += (nb > 0) ? nb : 1;
+        }
+        while (spanEnd < length && quickCheck.stableCodepoint(data + spanEnd, length - spanEnd) == 0);
+        const utf8proc_ssize_t nb = mapFragment(data + spanStart, spanEnd - spanStart, output, options);
+        if (nb < 0)
+            return nb;
+        pos = spanEnd;
+    }
+    return output.size() - initialSize;
+}
+
+// In title case, as appendAsciiTitle() does for ASCII characters.
+static utf8proc_int32_t titleCodepoint(utf8proc_int32_t codepoint, bool& inWord)
+{
+    switch (utf8proc_category(codepoint))
+    {
+        case UTF8PROC_CATEGORY_LU:
+        case UTF8PROC_CATEGORY_LL:
+        case UTF8PROC_CATEGORY_LT:
+        case UTF8PROC_CATEGORY_LM:
+        case UTF8PROC_CATEGORY_LO:
+        {
+            const utf8proc_int32_t mapped = inWord ? utf8proc_tolower(codepoint) : utf8proc_totitle(codepoint);
+            inWord = true;
+            return mapped;
+        }
+        case UTF8PROC_CATEGORY_MN:
+        case UTF8PROC_CATEGORY_MC:
+        case UTF8PROC_CATEGORY_ME:
+            break;
+        case UTF8PROC_CATEGORY_ND:
+        case UTF8PROC_CATEGORY_NL:
+        case UTF8PROC_CATEGORY_NO:
+            inWord = true;
+            break;
+        default:
+            if (codepoint != 0x2019) // Right single quotation mark, as an apostrophe.
+                inWord = false;
+            break;
+    }
+    return utf8proc_tolower(codepoint);
+}
+
+static void appendCodepoint(utf8proc_int32_t codepoint, string& output)
+{
+    utf8proc_uint8_t bytes[4];
+    output.append((const char*) bytes, utf8proc_encode_char(codepoint, bytes));
+}
+
+utf8proc_ssize_t caseFragment(const char * data, size_t length, string& output, u7::CaseMapping mapping)
+{
+    const size_t initialSize = output.size();
+    bool inWord = false;
+    size_t pos = 0;
+    while (pos < length)
+    {
+        if ((unsigned char) data[pos] < 0x80)
+        {
+            if (mapping == u7::CASE_TITLE)
+                pos += appendAsciiTitle(data + pos, length - pos, inWord, output);
+            else
+                pos += appendAsciiCase(data + pos, length - pos, mapping == u7::CASE_UPPER, output);
+            continue;
+        }
+        utf8proc_int32_t codepoint;
+        const utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t*) data + pos, length - pos, &codepoint);
+        if (nb < 0)
+            return nb;
+        pos += nb;
+        switch (mapping)
+        {
+            case u7::CASE_UPPER:
+                appendCodepoint(utf8proc_toupper(codepoint), output);
+                break;
+            case u7::CASE_TITLE:
+                appendCodepoint(titleCodepoint(codepoint, inWord), output);
+                break;
+            case u7::CASE_FOLD:
+            {
+                // Full case folding may yield up to three codepoints, as with 'ΐ'.
+                utf8proc_int32_t folded[8];
+                int boundClass = 0;
+                const utf8proc_ssize_t nbOfCodepoints = utf8proc_decompose_char(codepoint, folded, 8,
+                                                                               UTF8PROC_CASEFOLD, &boundClass);
+                if (nbOfCodepoints < 0)
+                    return nbOfCodepoints;
+                if (nbOfCodepoints > 8)
+                    return UTF8PROC_ERROR_OVERFLOW;
+                for (utf8proc_ssize_t i = 0; i < nbOfCodepoints; i++)
+                    appendCodepoint(folded[i], output);
+            }
+                break;
+            default:
+                appendCodepoint(utf8proc_tolower(codepoint), output);
+                break;
+        }
+    }
+    return output.size() - initialSize;
+}
+
+bool endsWord(utf8proc_int32_t codepoint)
+{
+    switch (utf8proc_category(codepoint))
+    {
+        case UTF8PROC_CATEGORY_LU:
+        case UTF8PROC_CATEGORY_LL:
+        case UTF8PROC_CATEGORY_LT:
+        case UTF8PROC_CATEGORY_LM:
+        case UTF8PROC_CATEGORY_LO:
+        case UTF8PROC_CATEGORY_MN:
+        case UTF8PROC_CATEGORY_MC:
+        case UTF8PROC_CATEGORY_ME:
+        case UTF8PROC_CATEGORY_ND:
+        case UTF8PROC_CATEGORY_NL:
+        case UTF8PROC_CATEGORY_NO:
+            return false;
+        default:
+            return codepoint != '\'' && codepoint != 0x2019;
+    }
+}
+
+// Length of the white space codepoint at 'data', 0 if it is not one.
+static size_t spaceLength(const char * data, size_t length)
+{
+    const unsigned char byte = data[0];
+    // Tabs are mapped to spaces and the other ASCII controls are stripped.
+    if (byte < 0x80)
+        return byte == ' ';
+    if (byte < 0xE1 && byte != 0xC2) // Below U+0080 to U+00BF and U+1680, there is none.
+        return 0;
+    utf8proc_int32_t codepoint;
+    const utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t*) data, length, &codepoint);
+    if (nb < 0)
+        return 0;
+    switch (utf8proc_category(codepoint))
+    {
+        case UTF8PROC_CATEGORY_ZS:
+        case UTF8PROC_CATEGORY_ZL:
+        case UTF8PROC_CATEGORY_ZP:
+            return nb;
+        default:
+            return 0;
+    }
+}
+
+void appendCollapsed(const char * data, size_t length, SpaceRun& run, string& output)
+{
+    size_t pos = 0;
+    while (pos < length)
+    {
+        size_t end = pos;
+        size_t space = 0;
+        while (end < length)
+        {
+            const unsigned char byte = data[end];
+            if (byte < 0x80 && byte != ' ')
+            {
+                end++;
+                continue;
+            }
+            space = spaceLength(data + end, length - end);
+            if (space)
+                break;
+            end = min(length, end + (byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2));
+        }
+        if (end > pos)
+        {
+            if (run.pending)
+                output.push_back(' ');
+            output.append(data + pos, end - pos);
+            run.started = true;
+            run.pending = false;
+        }
+        if (end == length)
+            break;
+        run.pending = run.started;
+        pos = end + space;
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * File:   Transforms.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include <string>
+#include <functional>
+#include <utf8proc.h>
+#include "U7.h"
+
+class QuickCheck;
+
+#define STRIP_OPTIONS_DEFAULT (UTF8PROC_IGNORE | UTF8PROC_STRIPCC | UTF8PROC_STRIPMARK | UTF8PROC_STRIPNA | UTF8PROC_DECOMPOSE | UTF8PROC_STABLE | UTF8PROC_NULLTERM)
+// NFKC_Casefold followed by unaccent -r, in a single mapping by mapFragment().
+#define SEARCHKEY_OPTIONS (UTF8PROC_STABLE | UTF8PROC_COMPOSE | UTF8PROC_COMPAT | UTF8PROC_CASEFOLD | UTF8PROC_IGNORE | UTF8PROC_STRIPCC | UTF8PROC_STRIPMARK | UTF8PROC_STRIPNA)
+
+/*
+ * A codepoint before which the input can be cut without altering the result
+ * of unaccent or normalize, unless a compatibility mapping alters it: a
+ * starter that does not compose with what precedes it and that none of the
+ * options strips.
+ */
+bool isStableStarter(utf8proc_int32_t codepoint);
+
+/*
+ * Whether the mapping of 'codepoint' with utf8proc 'options' starts with a
+ * stable starter, or a leading jamo, so that the input can be cut before it
+ * without altering the result. Under NFKC, U+FF9E maps to a combining mark,
+ * while U+FF76 maps to a kana that nothing composes with.
+ */
+bool mapsToStarter(utf8proc_int32_t codepoint, int options);
+
+/*
+ * Offset of the last codepoint of 'data' before which 'boundary' tells that it
+ * can be cut, 0 if none is found.
+ */
+size_t lastBoundary(const char * data, size_t length, const std::function<bool(utf8proc_int32_t codepoint)>& boundary);
+
+/*
+ * Offset of the last codepoint boundary of 'data', so that an incomplete
+ * trailing sequence is not split.
+ */
+size_t lastCodepointBoundary(const char * data, size_t length);
+
+// Options of utf8proc_map() equivalent to utf8proc_NFC() and siblings; -1 if the type is unknown.
+int normalizationOptions(const std::string& type);
+
+/*
+ * Maps a fragment that is not NULL terminated and appends the result to
+ * 'output', as utf8proc_map() would, in a per-thread buffer that is reused.
+ * When the options both fold the case and strip marks, a mark that has a case
+ * folding, as U+0345 has, is folded instead of being stripped.
+ * Returns the number of bytes appended or a negative utf8proc error code.
+ */
+utf8proc_ssize_t mapFragment(const char * data, size_t length, std::string& output, int options);
+
+// Options of utf8proc_map() equivalent to unaccent with 'options'.
+constexpr int unaccentFlags(const u7::UnaccentOptions& options)
+{
+    int flags = STRIP_OPTIONS_DEFAULT;
+    if (options.keepIgnorable)
+        flags ^= UTF8PROC_IGNORE;
+    if (options.keepControl)
+        flags ^= UTF8PROC_STRIPCC;
+    if (options.keepMarks)
+        flags ^= UTF8PROC_STRIPMARK;
+    if (options.keepUnassigned)
+        flags ^= UTF8PROC_STRIPNA;
+    if (options.recompose)
+    {
+        // Interestingly, UTF8PROC_COMPOSE gives the same result as UTF8PROC_DECOMPOSE.
+        // Probably the options mean : decompose, strip, compose ?
+        flags ^= UTF8PROC_DECOMPOSE;
+        flags |= UTF8PROC_COMPOSE;
+    }
+    return flags;
+}
+
+typedef utf8proc_ssize_t (*FragmentFunction)(const char * data, size_t length, std::string& output);
+
+/*
+ * Same as mapFragment() with unaccentFlags(options). Runs of printable
+ * ASCII characters, which none of the options alters, are copied as is, as
+ * are control characters when they are kept; only the spans between them,
+ * with the preceding character as context, are mapped.
+ * Within a span, the BMP stable starters are looked up in an UnaccentTable,
+ * and what the options strip after them, such as marks, is skipped.
+ * The function is compiled for each of the 32 combinations of the options,
+ * without testing them per codepoint; it is chosen here, once.
+ */
+FragmentFunction unaccentKernel(const u7::UnaccentOptions& options);
+
+// Same as mapFragment() with SEARCHKEY_OPTIONS, as unaccentKernel() does; ASCII runs are lowercased.
+utf8proc_ssize_t searchKeyFragment(const char * data, size_t length, std::string& output);
+
+/*
+ * Same as mapFragment() with normalization options. Codepoints that pass the
+ * quick check are copied as is; only the spans that do not, with the
+ * preceding codepoint as context, are mapped.
+ */
+utf8proc_ssize_t normalizeFragment(const char * data, size_t length, std::string& output, int options,
+                                   const QuickCheck& quickCheck);
+
+/*
+ * Maps the case of every codepoint; ASCII runs are converted with SIMD. In
+ * title case, the fragment starts outside a word.
+ * Returns the number of bytes appended or a negative utf8proc error code.
+ */
+utf8proc_ssize_t caseFragment(const char * data, size_t length, std::string& output, u7::CaseMapping mapping);
+
+// Whether 'codepoint' ends a word in title case: not a letter, a mark, a number or an apostrophe.
+bool endsWord(utf8proc_int32_t codepoint);
+
+// What appendCollapsed() carries from a fragment of a line to the next.
+struct SpaceRun
+{
+    // A codepoint other than white space was appended.
+    bool started = false;
+    // White space followed it.
+    bool pending = false;
+};
+
+/*
+ * Appends 'data' with each run of white space replaced by a single space, and
+ * none at the start or at the end of the line. A fresh SpaceRun starts a line.
+ */
+void appendCollapsed(const char * data, size_t length, SpaceRun& run, std::string& output);
+
+#endif // TRANSFORMS_H
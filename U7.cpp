@@ -0,0 +1,725 @@
+/*
+ * File:   U7.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "U7.h"
+#include "Transforms.h"
+#include "QuickCheck.h"
+#include "Ascii.h"
+#include "ByteTables.h"
+#include "Descriptions.h"
+#include "Segmenter.h"
+#include "Utf8.h"
+#include <cstring>
+
+using namespace std;
+
+// Calls 'operation' on a per-thread buffer and passes the result to 'sink'.
+template <typename Operation>
+static utf8proc_ssize_t toSink(const u7::Sink& sink, Operation operation)
+{
+    thread_local string result;
+    result.clear();
+    const utf8proc_ssize_t nb = operation(result);
+    if (nb >= 0)
+        sink(result);
+    return nb;
+}
+
+utf8proc_ssize_t u7::unaccent(string_view input, const UnaccentOptions& options, string& output)
+{
+    return unaccentKernel(options)(input.data(), input.size(), output);
+}
+
+utf8proc_ssize_t u7::unaccent(string_view input, const UnaccentOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return unaccent(input, options, result); });
+}
+
+u7::Unaccenter::Unaccenter(const UnaccentOptions& options)
+    : m_kernel(unaccentKernel(options))
+{
+}
+
+/*
+ * Whole inputs only: the last character of an unchanged prefix may still
+ * compose with what follows it, as 'E' with U+0301 when recomposing.
+ */
+bool u7::unchanged(string_view input, const UnaccentOptions& options)
+{
+    // None of the options alters printable ASCII characters, nor control characters when they are kept.
+    if (options.keepControl)
+        return asciiPrefix(input.data(), input.size()) == input.size();
+    return printableAsciiPrefix(input.data(), input.size()) == input.size();
+}
+
+bool u7::boundaryBefore(utf8proc_int32_t codepoint, const UnaccentOptions&)
+{
+    return isStableStarter(codepoint);
+}
+
+static const char * const normalizationForms[] = {"NFC", "NFD", "NFKC", "NFKD", "NFKC_Casefold"};
+
+bool u7::normalizationForm(string_view name, NormalizationForm& form)
+{
+    for (int i = NFC; i <= NFKC_CASEFOLD; i++)
+    {
+        if (name == normalizationForms[i])
+        {
+            form = NormalizationForm(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int normalizationOptions(u7::NormalizationForm form)
+{
+    return normalizationOptions(normalizationForms[form]);
+}
+
+// Built on first use, one per form.
+static const QuickCheck& quickCheck(u7::NormalizationForm form)
+{
+    switch (form)
+    {
+        case u7::NFD:
+        {
+            static const QuickCheck nfd(normalizationOptions(form));
+            return nfd;
+        }
+        case u7::NFKC:
+        {
+            static const QuickCheck nfkc(normalizationOptions(form));
+            return nfkc;
+        }
+        case u7::NFKD:
+        {
+            static const QuickCheck nfkd(normalizationOptions(form));
+            return nfkd;
+        }
+        case u7::NFKC_CASEFOLD:
+        {
+            static const QuickCheck nfkcCasefold(normalizationOptions(form));
+            return nfkcCasefold;
+        }
+        default:
+        {
+            static const QuickCheck nfc(normalizationOptions(u7::NFC));
+            return nfc;
+        }
+    }
+}
+
+utf8proc_ssize_t u7::normalize(string_view input, const NormalizeOptions& options, string& output)
+{
+    return normalizeFragment(input.data(), input.size(), output, normalizationOptions(options.form),
+                             quickCheck(options.form));
+}
+
+utf8proc_ssize_t u7::normalize(string_view input, const NormalizeOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return normalize(input, options, result); });
+}
+
+bool u7::unchanged(string_view input, const NormalizeOptions& options)
+{
+    return quickCheck(options.form).stablePrefix(input.data(), input.size()) == input.size();
+}
+
+bool u7::boundaryBefore(utf8proc_int32_t codepoint, const NormalizeOptions& options)
+{
+    // A compatibility or case mapping may start with a character that composes with what precedes.
+    return mapsToStarter(codepoint, normalizationOptions(options.form));
+}
+
+bool u7::isNormalized(string_view input, const NormalizeOptions& options)
+{
+    if (quickCheck(options.form).check(input.data(), input.size()) == QUICKCHECK_YES)
+        return true;
+    // What the quick check cannot vouch for is normalized and compared.
+    thread_local string normalized;
+    normalized.clear();
+    return normalize(input, options, normalized) >= 0 && normalized == input;
+}
+
+static const QuickCheck& searchKeyCheck()
+{
+    static const QuickCheck check(SEARCHKEY_OPTIONS);
+    return check;
+}
+
+utf8proc_ssize_t u7::searchKey(string_view input, const SearchKeyOptions& options, string& output)
+{
+    if (!options.collapseSpaces)
+        return searchKeyFragment(input.data(), input.size(), output);
+    thread_local string key;
+    key.clear();
+    const utf8proc_ssize_t nb = searchKeyFragment(input.data(), input.size(), key);
+    if (nb < 0)
+        return nb;
+    const size_t initialSize = output.size();
+    SpaceRun run;
+    appendCollapsed(key.data(), key.size(), run, output);
+    return output.size() - initialSize;
+}
+
+utf8proc_ssize_t u7::searchKey(string_view input, const SearchKeyOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return searchKey(input, options, result); });
+}
+
+bool u7::unchanged(string_view input, const SearchKeyOptions& options)
+{
+    // Spaces are unchanged codepoints, but not their runs.
+    if (options.collapseSpaces)
+        return input.empty();
+    return searchKeyCheck().stablePrefix(input.data(), input.size()) == input.size();
+}
+
+bool u7::boundaryBefore(utf8proc_int32_t codepoint, const SearchKeyOptions&)
+{
+    return mapsToStarter(codepoint, SEARCHKEY_OPTIONS);
+}
+
+size_t u7::repair(string_view input, const RepairOptions& options, string& output, vector<InvalidSequence> * invalid)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < input.size())
+    {
+        const size_t valid = validUtf8Prefix(input.data() + pos, input.size() - pos);
+        output.append(input.data() + pos, valid);
+        pos += valid;
+        if (pos == input.size())
+            break;
+        const size_t length = -utf8SequenceLength(input.data() + pos, input.size() - pos);
+        if (!options.drop)
+            output += "\xEF\xBF\xBD";
+        if (invalid)
+            invalid->push_back({pos, length});
+        count++;
+        pos += length;
+    }
+    return count;
+}
+
+size_t u7::validPrefix(string_view input)
+{
+    return validUtf8Prefix(input.data(), input.size());
+}
+
+utf8proc_ssize_t u7::mapCase(string_view input, const CaseOptions& options, string& output)
+{
+    return caseFragment(input.data(), input.size(), output, options.mapping);
+}
+
+bool u7::boundaryBefore(utf8proc_int32_t codepoint, const CaseOptions& options)
+{
+    if (options.mapping == CASE_TITLE && !endsWord(codepoint))
+        return false;
+    return isStableStarter(codepoint);
+}
+
+utf8proc_ssize_t u7::mapCase(string_view input, const CaseOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return mapCase(input, options, result); });
+}
+
+utf8proc_ssize_t u7::segment(string_view input, const SegmentOptions& options, string& output)
+{
+    const size_t initialSize = output.size();
+    Segmenter segmenter(options.width);
+    size_t start = 0;
+    while (start < input.size())
+    {
+        const size_t end = min(input.find('\n', start), input.size());
+        const utf8proc_ssize_t nb = segmenter.feed(input.data() + start, end - start, output);
+        if (nb < 0)
+            return nb;
+        segmenter.end(output);
+        start = end + 1;
+    }
+    return output.size() - initialSize;
+}
+
+utf8proc_ssize_t u7::segment(string_view input, const SegmentOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return segment(input, options, result); });
+}
+
+// Appends 'number' in uppercase hexadecimal, zero-padded to 'minDigits'.
+static void appendHex(string& output, const char * prefix, utf8proc_uint32_t number, int minDigits)
+{
+    const char digits[] = "0123456789ABCDEF";
+    char buffer[8];
+    int nbOfDigits = 0;
+    do
+    {
+        buffer[nbOfDigits++] = digits[number & 0xF];
+        number >>= 4;
+    } while (number);
+    output += prefix;
+    for (int i = nbOfDigits; i < minDigits; i++)
+        output.push_back('0');
+    while (nbOfDigits)
+        output.push_back(buffer[--nbOfDigits]);
+}
+
+// https://en.wikipedia.org/wiki/UTF-16
+static int utf16Units(utf8proc_int32_t codepoint, utf8proc_int32_t units[2])
+{
+    if (codepoint < 0xFFFF) // 2 bytes only
+    {
+        units[0] = codepoint;
+        return 1;
+    }
+    // 4 bytes
+    utf8proc_int32_t intermediate = codepoint - 0x10000;
+    utf8proc_int32_t shifted = intermediate >> 10; // Divide by 0x400 (1024)(2^10)
+    units[0] = shifted +  0xD800; // High surrogate
+    utf8proc_int32_t lowTenBits = intermediate % 0x400; // Same result with (intermediate & 1023)
+    units[1] = lowTenBits + 0xDC00; // Low surrogate
+    return 2;
+}
+
+/*
+ * Appends the cells of a row: tab separated values, or a JSON object.
+ */
+class RowWriter
+{
+public:
+    RowWriter(string& output, bool json) : m_output(output), m_json(json) {}
+    void cell(const char * name, string_view value)
+    {
+        if (m_json)
+        {
+            m_output += m_first ? "{\"" : ",\"";
+            m_output += name;
+            m_output += "\":\"";
+        }
+        else if (!m_first)
+        {
+            m_output.push_back('\t');
+        }
+        m_first = false;
+        escape(value);
+        if (m_json)
+            m_output.push_back('"');
+    }
+    void end()
+    {
+        if (m_json)
+            m_output.push_back('}');
+        m_output.push_back('\n');
+        m_first = true;
+    }
+
+private:
+    string& m_output;
+    bool m_json;
+    bool m_first = true;
+    
+    void escape(string_view value)
+    {
+        for (unsigned char c : value)
+        {
+            switch (c)
+            {
+                case '\t':
+                    m_output += "\\t";
+                    break;
+                case '\n':
+                    m_output += "\\n";
+                    break;
+                case '\r':
+                    m_output += "\\r";
+                    break;
+                case '\\':
+                    m_output += "\\\\";
+                    break;
+                case '"':
+                    if (m_json)
+                        m_output += "\\\"";
+                    else
+                        m_output.push_back(c);
+                    break;
+                default:
+                    if (m_json && (c < 0x20 || c == 0x7F))
+                        appendHex(m_output, "\\u", c, 4);
+                    else
+                        m_output.push_back(c);
+                    break;
+            }
+        }
+    }
+};
+
+const char * u7::columnName(Representation column)
+{
+    static const char * const names[] = {"codepoint", "utf8", "utf16", "binary", "octal", "decimal", "xml",
+                                         "tolower", "toupper", "totitle"};
+    return column >= CODEPOINT && column <= TOTITLE ? names[column] : "";
+}
+
+const char * u7::columnName(Property column)
+{
+    static const char * const names[] = {"islower", "isupper", "category", "direction", "decompositiontype",
+                                         "boundclass"};
+    return column >= ISLOWER && column <= BOUNDCLASS ? names[column] : "";
+}
+
+void u7::representation(utf8proc_int32_t codepoint, Representation column, string& output)
+{
+    switch (column)
+    {
+        case CODEPOINT:
+            appendHex(output, "U+", codepoint, 4);
+            break;
+        case UTF8:
+        case BINARY:
+        case OCTAL:
+        case DECIMAL:
+        {
+            const int base = column == UTF8 ? 16 : column == BINARY ? 2 : column == OCTAL ? 8 : 10;
+            utf8proc_uint8_t bytes[4];
+            const utf8proc_ssize_t length = utf8proc_encode_char(codepoint, bytes);
+            for (utf8proc_ssize_t i = 0; i < length; i++)
+            {
+                if (i)
+                    output.push_back(' ');
+                output += byteRepresentation(bytes[i], base);
+            }
+        }
+            break;
+        case UTF16:
+        {
+            utf8proc_int32_t units[2];
+            const int nbOfUnits = utf16Units(codepoint, units);
+            for (int i = 0; i < nbOfUnits; i++)
+            {
+                if (i)
+                    output.push_back(' ');
+                appendHex(output, "0x", units[i], 4);
+            }
+        }
+            break;
+        case XML:
+            output += "&#";
+            output += to_string(codepoint);
+            output.push_back(';');
+            break;
+        case TOLOWER:
+        case TOUPPER:
+        case TOTITLE:
+        {
+            const utf8proc_int32_t mapped = column == TOLOWER ? utf8proc_tolower(codepoint)
+                : column == TOUPPER ? utf8proc_toupper(codepoint) : utf8proc_totitle(codepoint);
+            utf8proc_uint8_t dst[4];
+            const utf8proc_ssize_t bytesWritten = utf8proc_encode_char(mapped, dst);
+            output.append((const char*) dst, bytesWritten);
+        }
+            break;
+        default:
+            break;
+    }
+}
+
+void u7::property(utf8proc_int32_t codepoint, Property column, string& output)
+{
+    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
+    switch (column)
+    {
+        case ISLOWER:
+            output.push_back(utf8proc_islower(codepoint) ? '1' : '0');
+            break;
+        case ISUPPER:
+            output.push_back(utf8proc_isupper(codepoint) ? '1' : '0');
+            break;
+        case CATEGORY:
+            output.push_back('[');
+            output += utf8proc_category_string(codepoint);
+            output += "] ";
+            output += categoryDescription(property->category);
+            break;
+        case DIRECTION:
+            output += bidirectionalDescription(property->bidi_class);
+            break;
+        case DECOMPOSITION_TYPE:
+            output += decompositionTypeDescription(property->decomp_type);
+            break;
+        case BOUNDCLASS:
+            output += boundClassDescription(property->boundclass);
+            break;
+        default:
+            break;
+    }
+}
+
+template <typename Options>
+static void appendHeader(const Options& options, string& output)
+{
+    for (auto column : options.columns)
+    {
+        output += u7::columnName(column);
+        output.push_back('\t');
+    }
+    output += "character\n";
+}
+
+void u7::header(const RepresentationOptions& options, string& output)
+{
+    appendHeader(options, output);
+}
+
+void u7::header(const PropertiesOptions& options, string& output)
+{
+    appendHeader(options, output);
+}
+
+static void appendValue(utf8proc_int32_t codepoint, u7::Representation column, string& output)
+{
+    u7::representation(codepoint, column, output);
+}
+
+static void appendValue(utf8proc_int32_t codepoint, u7::Property column, string& output)
+{
+    u7::property(codepoint, column, output);
+}
+
+template <typename Options>
+static void appendRow(utf8proc_int32_t codepoint, const Options& options, string& output)
+{
+    thread_local string value;
+    RowWriter row(output, options.format == u7::ROW_JSON);
+    for (auto column : options.columns)
+    {
+        value.clear();
+        appendValue(codepoint, column, value);
+        row.cell(u7::columnName(column), value);
+    }
+    utf8proc_uint8_t character[4];
+    const utf8proc_ssize_t length = utf8proc_encode_char(codepoint, character);
+    row.cell("character", string_view((const char*) character, length));
+    row.end();
+}
+
+void u7::row(utf8proc_int32_t codepoint, const RepresentationOptions& options, string& output)
+{
+    appendRow(codepoint, options, output);
+}
+
+void u7::row(utf8proc_int32_t codepoint, const PropertiesOptions& options, string& output)
+{
+    appendRow(codepoint, options, output);
+}
+
+template <typename Options>
+static utf8proc_ssize_t appendRows(string_view input, const Options& options, string& output)
+{
+    const size_t initialSize = output.size();
+    size_t offset = 0;
+    while (offset < input.size())
+    {
+        utf8proc_int32_t codepoint;
+        const utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t *) input.data() + offset,
+                                                     input.size() - offset, &codepoint);
+        if (nb < 0)
+            return nb;
+        appendRow(codepoint, options, output);
+        offset += nb;
+    }
+    return output.size() - initialSize;
+}
+
+utf8proc_ssize_t u7::representation(string_view input, const RepresentationOptions& options, string& output)
+{
+    return appendRows(input, options, output);
+}
+
+utf8proc_ssize_t u7::representation(string_view input, const RepresentationOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return representation(input, options, result); });
+}
+
+utf8proc_ssize_t u7::properties(string_view input, const PropertiesOptions& options, string& output)
+{
+    return appendRows(input, options, output);
+}
+
+utf8proc_ssize_t u7::properties(string_view input, const PropertiesOptions& options, const Sink& sink)
+{
+    return toSink(sink, [&](string& result) { return properties(input, options, result); });
+}
+
+void u7::PropertyCensus::add(const PropertyCensus& other)
+{
+    bytes += other.bytes;
+    codepoints += other.codepoints;
+    for (size_t i = 0; i < size(categories); i++)
+        categories[i] += other.categories[i];
+    for (size_t i = 0; i < size(bidiClasses); i++)
+        bidiClasses[i] += other.bidiClasses[i];
+    for (size_t i = 0; i < size(decompositionTypes); i++)
+        decompositionTypes[i] += other.decompositionTypes[i];
+    for (size_t i = 0; i < size(boundClasses); i++)
+        boundClasses[i] += other.boundClasses[i];
+    for (size_t i = 0; i < size(ascii); i++)
+        ascii[i] += other.ascii[i];
+    nonNfcSpans += other.nonNfcSpans;
+    nonNfcBytes += other.nonNfcBytes;
+    invalidSequences += other.invalidSequences;
+    invalidBytes += other.invalidBytes;
+}
+
+static void countProperty(const utf8proc_property_t * property, uint64_t count, u7::PropertyCensus& census)
+{
+    census.categories[property->category] += count;
+    census.bidiClasses[property->bidi_class] += count;
+    census.decompositionTypes[property->decomp_type] += count;
+    census.boundClasses[property->boundclass] += count;
+}
+
+void u7::countProperties(string_view input, PropertyCensus& census)
+{
+    const QuickCheck& nfc = quickCheck(NFC);
+    const NormalizeOptions nfcOptions;
+    const char * data = input.data();
+    const size_t length = input.size();
+    // Four tallies, so that a run of the same character does not wait on a single counter.
+    uint64_t ascii[4][0x80] = {};
+    // A span is normalized and compared only if one of its codepoints may be altered.
+    size_t spanStart = 0;
+    bool spanUnsure = false;
+    auto closeSpan = [&](size_t end) {
+        if (!spanUnsure)
+            return;
+        spanUnsure = false;
+        if (!isNormalized(string_view(data + spanStart, end - spanStart), nfcOptions))
+        {
+            census.nonNfcSpans++;
+            census.nonNfcBytes += end - spanStart;
+        }
+    };
+    // Sequences are checked a well-formed run at a time, and decoded without checks.
+    size_t valid = validUtf8Prefix(data, length);
+    size_t pos = 0;
+    while (pos < length)
+    {
+        if (pos == valid)
+        {
+            closeSpan(pos);
+            census.invalidSequences++;
+            pos += -utf8SequenceLength(data + pos, length - pos);
+            census.invalidBytes += pos - valid;
+            spanStart = pos;
+            valid = pos + validUtf8Prefix(data + pos, length - pos);
+            continue;
+        }
+        const unsigned char * bytes = (const unsigned char*) data + pos;
+        if (bytes[0] < 0x80)
+        {
+            // ASCII characters are starters that nothing composes with.
+            closeSpan(pos);
+            const size_t start = pos;
+            uint32_t word;
+            while (pos + 4 <= valid)
+            {
+                memcpy(&word, data + pos, 4);
+                if (word & 0x80808080)
+                    break;
+                ascii[0][word & 0xFF]++;
+                ascii[1][(word >> 8) & 0xFF]++;
+                ascii[2][(word >> 16) & 0xFF]++;
+                ascii[3][word >> 24]++;
+                pos += 4;
+            }
+            while (pos < valid && (unsigned char) data[pos] < 0x80)
+                ascii[0][(unsigned char) data[pos++]]++;
+            census.codepoints += pos - start;
+            spanStart = pos - 1;
+            continue;
+        }
+        utf8proc_int32_t codepoint;
+        int nb;
+        if (bytes[0] < 0xE0)
+        {
+            codepoint = (bytes[0] & 0x1F) << 6 | (bytes[1] & 0x3F);
+            nb = 2;
+        }
+        else if (bytes[0] < 0xF0)
+        {
+            codepoint = (bytes[0] & 0x0F) << 12 | (bytes[1] & 0x3F) << 6 | (bytes[2] & 0x3F);
+            nb = 3;
+        }
+        else
+        {
+            codepoint = (bytes[0] & 0x07) << 18 | (bytes[1] & 0x3F) << 12 | (bytes[2] & 0x3F) << 6 | (bytes[3] & 0x3F);
+            nb = 4;
+        }
+        countProperty(utf8proc_get_property(codepoint), 1, census);
+        census.codepoints++;
+        if (nfc.codepoint(codepoint) == QUICKCHECK_YES)
+        {
+            closeSpan(pos);
+            spanStart = pos;
+        }
+        else
+        {
+            spanUnsure = true;
+        }
+        pos += nb;
+    }
+    closeSpan(length);
+    census.bytes += length;
+    for (int c = 0; c < 0x80; c++)
+        census.ascii[c] += ascii[0][c] + ascii[1][c] + ascii[2][c] + ascii[3][c];
+}
+
+// Appends the non-null counts of a histogram, keyed by the descriptions of their values, or by the values.
+template <size_t N>
+static void appendHistogram(string& output, const char * name, const uint64_t (&counts)[N],
+                            const char * (*describe)(int))
+{
+    output += ", \"";
+    output += name;
+    output += "\": {";
+    bool first = true;
+    for (size_t value = 0; value < N; value++)
+    {
+        if (counts[value] == 0)
+            continue;
+        const char * description = describe(value);
+        output += first ? "\"" : ", \"";
+        output += *description ? string(description) : to_string(value);
+        output += "\": " + to_string(counts[value]);
+        first = false;
+    }
+    output += "}";
+}
+
+void u7::censusReport(const PropertyCensus& census, string& output)
+{
+    PropertyCensus total = census;
+    for (int c = 0; c < 0x80; c++)
+    {
+        if (census.ascii[c])
+            countProperty(utf8proc_get_property(c), census.ascii[c], total);
+    }
+    output += "{\"bytes\": " + to_string(total.bytes);
+    output += ", \"codepoints\": " + to_string(total.codepoints);
+    output += ", \"invalid\": {\"sequences\": " + to_string(total.invalidSequences);
+    output += ", \"bytes\": " + to_string(total.invalidBytes) + "}";
+    output += ", \"non_nfc\": {\"spans\": " + to_string(total.nonNfcSpans);
+    output += ", \"bytes\": " + to_string(total.nonNfcBytes) + "}";
+    appendHistogram(output, columnName(CATEGORY), total.categories, categoryDescription);
+    appendHistogram(output, columnName(DIRECTION), total.bidiClasses, bidirectionalDescription);
+    appendHistogram(output, columnName(DECOMPOSITION_TYPE), total.decompositionTypes, decompositionTypeDescription);
+    appendHistogram(output, columnName(BOUNDCLASS), total.boundClasses, boundClassDescription);
+    output += "}";
+}
@@ -0,0 +1,276 @@
+/*
+ * File:   U7.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef U7_H
+#define U7_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <utf8proc.h>
+
+/*
+ * The operations of utf8util, for in-process use.
+ * The input is not NULL terminated and is not copied. Results are appended to
+ * a string owned by the caller, whose capacity is reused from call to call,
+ * or passed to a sink. Nothing is printed, and no allocation is made once
+ * the output and the per-thread buffers have grown to size.
+ * All functions are safe to call concurrently.
+ */
+namespace u7
+{
+    /*
+     * Receives the result of an operation; the view is valid during the call only.
+     */
+    typedef std::function<void(std::string_view result)> Sink;
+    
+    /*
+     * By default, every removable codepoint is stripped, the output characters
+     * are decomposed and Unicode Versioning Stability is enforced.
+     */
+    struct UnaccentOptions
+    {
+        bool keepIgnorable = false;
+        bool keepControl = false;
+        bool keepMarks = false;
+        bool keepUnassigned = false;
+        bool recompose = false;
+    };
+    
+    /*
+     * Removes character markings, control characters, default ignorable
+     * characters and unassigned codepoints.
+     * Returns the number of bytes appended or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t unaccent(std::string_view input, const UnaccentOptions& options, std::string& output);
+    utf8proc_ssize_t unaccent(std::string_view input, const UnaccentOptions& options, const Sink& sink);
+    
+    /*
+     * unaccent() with its options resolved once, for repeated calls: it runs
+     * code compiled for this combination of options.
+     */
+    class Unaccenter
+    {
+    public:
+        explicit Unaccenter(const UnaccentOptions& options);
+        utf8proc_ssize_t operator()(std::string_view input, std::string& output) const
+        {
+            return m_kernel(input.data(), input.size(), output);
+        }
+        
+    private:
+        utf8proc_ssize_t (*m_kernel)(const char * data, size_t length, std::string& output);
+    };
+    
+    /*
+     * Whether unaccent() leaves 'input' unchanged, as far as a check that maps
+     * nothing tells; false does not mean that it alters it.
+     */
+    bool unchanged(std::string_view input, const UnaccentOptions& options);
+    // Whether an input can be cut before 'codepoint', the parts being unaccented apart with the same result.
+    bool boundaryBefore(utf8proc_int32_t codepoint, const UnaccentOptions& options);
+    
+    enum NormalizationForm {NFC, NFD, NFKC, NFKD, NFKC_CASEFOLD};
+    
+    struct NormalizeOptions
+    {
+        NormalizationForm form = NFC;
+    };
+    
+    // NFC, NFD, NFKC, NFKD or NFKC_Casefold; false for any other name.
+    bool normalizationForm(std::string_view name, NormalizationForm& form);
+    
+    /*
+     * Returns the number of bytes appended or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t normalize(std::string_view input, const NormalizeOptions& options, std::string& output);
+    utf8proc_ssize_t normalize(std::string_view input, const NormalizeOptions& options, const Sink& sink);
+    // Whether normalize() leaves 'input' unchanged, as far as a quick check tells; see unchanged() above.
+    bool unchanged(std::string_view input, const NormalizeOptions& options);
+    /*
+     * Whether an input can be cut before 'codepoint', the parts being
+     * normalized apart with the same result: under NFKC, a halfwidth voiced
+     * sound mark composes with the preceding kana, for instance.
+     */
+    bool boundaryBefore(utf8proc_int32_t codepoint, const NormalizeOptions& options);
+    // False for invalid input.
+    bool isNormalized(std::string_view input, const NormalizeOptions& options);
+    
+    struct SearchKeyOptions
+    {
+        // Runs of white space become a single space, and none is kept at either end.
+        bool collapseSpaces = false;
+    };
+    
+    /*
+     * Maps to a key for caseless and accent-insensitive matching: NFKC_Casefold,
+     * then marks, control characters, default ignorable characters and
+     * unassigned codepoints are stripped and the result is recomposed, as
+     * normalize() to NFKC_Casefold then unaccent() with 'recompose' would, in
+     * a single mapping. A mark is folded before being stripped: U+0345 folds
+     * to U+03B9, which is kept, in both.
+     * Returns the number of bytes appended or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t searchKey(std::string_view input, const SearchKeyOptions& options, std::string& output);
+    utf8proc_ssize_t searchKey(std::string_view input, const SearchKeyOptions& options, const Sink& sink);
+    // Whether searchKey() leaves 'input' unchanged, as far as a quick check tells; see unchanged() above.
+    bool unchanged(std::string_view input, const SearchKeyOptions& options);
+    // Whether an input can be cut before 'codepoint', the parts being mapped apart with the same result.
+    bool boundaryBefore(utf8proc_int32_t codepoint, const SearchKeyOptions& options);
+    
+    struct RepairOptions
+    {
+        // Ill-formed subsequences are dropped instead of replaced with U+FFFD.
+        bool drop = false;
+    };
+    
+    // An ill-formed subsequence found by repair(), in bytes of its input.
+    struct InvalidSequence
+    {
+        size_t offset;
+        size_t length;
+    };
+    
+    /*
+     * Replaces each maximal subpart of an ill-formed subsequence with U+FFFD,
+     * or drops it, as the Unicode Standard and the WHATWG Encoding Standard
+     * recommend; valid UTF-8 is appended unchanged.
+     * If 'invalid' is not null, the subsequences are appended to it.
+     * Returns the number of them.
+     */
+    size_t repair(std::string_view input, const RepairOptions& options, std::string& output,
+                  std::vector<InvalidSequence> * invalid = NULL);
+    // Length of the well-formed start of 'input'; its whole length for valid UTF-8.
+    size_t validPrefix(std::string_view input);
+    
+    // In the order of the options of the case mode.
+    enum CaseMapping {CASE_LOWER, CASE_UPPER, CASE_TITLE, CASE_FOLD};
+    
+    struct CaseOptions
+    {
+        CaseMapping mapping = CASE_LOWER;
+    };
+    
+    /*
+     * Maps every codepoint to lower, upper or title case, one codepoint to
+     * one, or folds the case for caseless matching, which may change the length
+     * as with 'ß' to 'ss'. In title case, the first letter of each word is
+     * mapped to title case and the others to lower case; a word is a run of
+     * letters, marks, numbers and apostrophes.
+     * Returns the number of bytes appended or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t mapCase(std::string_view input, const CaseOptions& options, std::string& output);
+    utf8proc_ssize_t mapCase(std::string_view input, const CaseOptions& options, const Sink& sink);
+    /*
+     * Whether an input can be cut before 'codepoint', the parts being mapped
+     * apart with the same result: in title case, only before a codepoint that
+     * ends a word, as a part starts outside one.
+     */
+    bool boundaryBefore(utf8proc_int32_t codepoint, const CaseOptions& options);
+    
+    struct SegmentOptions
+    {
+        // Columns kept per line; 0 to count instead.
+        size_t width = 0;
+    };
+    
+    /*
+     * For each line of 'input', appends its number of grapheme clusters and its
+     * display width, tab separated, or, with a width, the line truncated to as
+     * many columns without splitting a grapheme cluster; then a newline.
+     * Returns the number of bytes appended or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t segment(std::string_view input, const SegmentOptions& options, std::string& output);
+    utf8proc_ssize_t segment(std::string_view input, const SegmentOptions& options, const Sink& sink);
+    
+    // In the order of the options of the representation mode.
+    enum Representation {CODEPOINT, UTF8, UTF16, BINARY, OCTAL, DECIMAL, XML, TOLOWER, TOUPPER, TOTITLE};
+    // In the order of the options of the properties mode.
+    enum Property {ISLOWER, ISUPPER, CATEGORY, DIRECTION, DECOMPOSITION_TYPE, BOUNDCLASS};
+    
+    /*
+     * Rows are tab separated values, tabs, newlines, carriage returns and
+     * backslashes being escaped, or JSON objects; one per line.
+     */
+    enum RowFormat {ROW_TSV, ROW_JSON};
+    
+    struct RepresentationOptions
+    {
+        std::vector<Representation> columns;
+        RowFormat format = ROW_TSV;
+    };
+    
+    struct PropertiesOptions
+    {
+        std::vector<Property> columns;
+        RowFormat format = ROW_TSV;
+    };
+    
+    // The long option name selecting the column.
+    const char * columnName(Representation column);
+    const char * columnName(Property column);
+    
+    // Appends the value of a column, unlabelled.
+    void representation(utf8proc_int32_t codepoint, Representation column, std::string& output);
+    void property(utf8proc_int32_t codepoint, Property column, std::string& output);
+    
+    // Appends the names of the columns, followed by 'character', as a TSV row.
+    void header(const RepresentationOptions& options, std::string& output);
+    void header(const PropertiesOptions& options, std::string& output);
+    
+    // Appends the row of a codepoint: the columns, followed by the character.
+    void row(utf8proc_int32_t codepoint, const RepresentationOptions& options, std::string& output);
+    void row(utf8proc_int32_t codepoint, const PropertiesOptions& options, std::string& output);
+    
+    /*
+     * Appends one row per codepoint of 'input'.
+     * Returns the number of bytes appended or a negative utf8proc error code.
+     */
+    utf8proc_ssize_t representation(std::string_view input, const RepresentationOptions& options, std::string& output);
+    utf8proc_ssize_t representation(std::string_view input, const RepresentationOptions& options, const Sink& sink);
+    utf8proc_ssize_t properties(std::string_view input, const PropertiesOptions& options, std::string& output);
+    utf8proc_ssize_t properties(std::string_view input, const PropertiesOptions& options, const Sink& sink);
+    
+    /*
+     * Histograms of the properties of the codepoints of an input, indexed by
+     * the values of utf8proc, with the spans that NFC alters and the
+     * ill-formed sequences. A span runs from a stable starter to the next.
+     */
+    struct PropertyCensus
+    {
+        uint64_t bytes = 0;
+        uint64_t codepoints = 0;
+        uint64_t categories[UTF8PROC_CATEGORY_CO + 1] = {};
+        uint64_t bidiClasses[UTF8PROC_BIDI_CLASS_PDI + 1] = {};
+        uint64_t decompositionTypes[UTF8PROC_DECOMP_TYPE_COMPAT + 1] = {};
+        uint64_t boundClasses[UTF8PROC_BOUNDCLASS_E_ZWG + 1] = {};
+        // ASCII characters are tallied apart, for speed; censusReport() adds them to the histograms.
+        uint64_t ascii[0x80] = {};
+        uint64_t nonNfcSpans = 0;
+        uint64_t nonNfcBytes = 0;
+        uint64_t invalidSequences = 0;
+        uint64_t invalidBytes = 0;
+        
+        // Adds the counts of another census, such as that of another thread.
+        void add(const PropertyCensus& other);
+    };
+    
+    /*
+     * Adds the codepoints of 'input' to 'census'. Spans are counted whole if
+     * the input is cut at stable starters, as the chunks of a stream are.
+     * Ill-formed sequences are counted as repair() would find them.
+     */
+    void countProperties(std::string_view input, PropertyCensus& census);
+    // Appends the census as a JSON object on a single line, keyed by the descriptions of properties().
+    void censusReport(const PropertyCensus& census, std::string& output);
+}
+
+#endif // U7_H
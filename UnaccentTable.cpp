@@ -0,0 +1,106 @@
+/*
+ * File:   UnaccentTable.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "UnaccentTable.h"
+#include "Transforms.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+using namespace std;
+
+UnaccentTable::UnaccentTable(int options)
+    : m_options(options & ~UTF8PROC_NULLTERM)
+{
+}
+
+UnaccentTable::~UnaccentTable()
+{
+    for (atomic<Block*>& block : m_blocks)
+        delete block.load();
+}
+
+void UnaccentTable::compute(utf8proc_int32_t codepoint, Entry& entry) const
+{
+    entry.length = NO_ENTRY;
+    if (!isStableStarter(codepoint))
+        return;
+    utf8proc_uint8_t bytes[4];
+    const utf8proc_ssize_t length = utf8proc_encode_char(codepoint, bytes);
+    string output;
+    if (mapFragment((const char*) bytes, length, output, m_options) < 0 || output.size() > UNACCENT_ENTRY_SIZE)
+        return;
+    // A compatibility mapping may yield a conjoining jamo, which composes with its neighbours.
+    if (m_options & UTF8PROC_COMPAT)
+    {
+        size_t pos = 0;
+        while (pos < output.size())
+        {
+            utf8proc_int32_t mapped;
+            const utf8proc_ssize_t nb = utf8proc_iterate((const utf8proc_uint8_t*) output.data() + pos, output.size() - pos, &mapped);
+            if (nb < 0 || !isStableStarter(mapped))
+                return;
+            pos += nb;
+        }
+    }
+    entry.length = output.size();
+    output.copy(entry.bytes, output.size());
+}
+
+const UnaccentTable::Block * UnaccentTable::block(utf8proc_int32_t codepoint) const
+{
+    const size_t index = codepoint >> 8;
+    Block * block = m_blocks[index].load(memory_order_acquire);
+    if (block)
+        return block;
+    lock_guard<mutex> lock(m_mutex);
+    block = m_blocks[index].load(memory_order_relaxed);
+    if (block)
+        return block;
+    block = new Block();
+    const utf8proc_int32_t first = codepoint & ~0xFF;
+    for (int i = 0; i < 256; i++)
+        compute(first + i, block->entries[i]);
+    m_blocks[index].store(block, memory_order_release);
+    return block;
+}
+
+const char * UnaccentTable::entry(utf8proc_int32_t codepoint, size_t& length) const
+{
+    if (codepoint < 0 || codepoint >= 0x10000)
+        return NULL;
+    const Entry& entry = block(codepoint)->entries[codepoint & 0xFF];
+    if (entry.length == NO_ENTRY)
+        return NULL;
+    length = entry.length;
+    return entry.bytes;
+}
+
+const UnaccentTable& UnaccentTable::forOptions(int options)
+{
+    options &= ~UTF8PROC_NULLTERM;
+    // The options rarely change within a thread.
+    thread_local const UnaccentTable * last = NULL;
+    if (last && last->m_options == options)
+        return *last;
+    static mutex tablesMutex;
+    static vector<unique_ptr<UnaccentTable>> tables;
+    lock_guard<mutex> lock(tablesMutex);
+    for (const unique_ptr<UnaccentTable>& table : tables)
+    {
+        if (table->m_options == options)
+        {
+            last = table.get();
+            return *last;
+        }
+    }
+    tables.push_back(make_unique<UnaccentTable>(options));
+    last = tables.back().get();
+    return *last;
+}
@@ -0,0 +1,59 @@
+/*
+ * File:   UnaccentTable.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef UNACCENTTABLE_H
+#define UNACCENTTABLE_H
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <utf8proc.h>
+
+// Longest output of a codepoint kept in a table; Greek with several accents and -m needs 8 bytes.
+#define UNACCENT_ENTRY_SIZE 11
+
+/*
+ * Output of unaccent for each codepoint of the BMP taken alone, for a set of
+ * utf8proc options. Only stable starters have an entry: between two of them,
+ * the output of a codepoint does not depend on its neighbours.
+ * With UTF8PROC_COMPAT, the output must also be made of stable starters.
+ * The entries are derived from utf8proc, per block of 256 codepoints, on first
+ * use; the tables can be shared by threads.
+ */
+class UnaccentTable
+{
+public:
+    explicit UnaccentTable(int options);
+    ~UnaccentTable();
+    // The output of 'codepoint', or NULL if it has no entry and must be mapped by utf8proc.
+    const char * entry(utf8proc_int32_t codepoint, size_t& length) const;
+    // A table per set of options, kept until exit.
+    static const UnaccentTable& forOptions(int options);
+
+private:
+    struct Entry
+    {
+        // NO_ENTRY if the codepoint has no entry.
+        uint8_t length;
+        char bytes[UNACCENT_ENTRY_SIZE];
+    };
+    struct Block
+    {
+        Entry entries[256];
+    };
+    static const uint8_t NO_ENTRY = 0xFF;
+    int m_options;
+    mutable std::atomic<Block*> m_blocks[0x10000 >> 8] = {};
+    mutable std::mutex m_mutex;
+
+    const Block * block(utf8proc_int32_t codepoint) const;
+    void compute(utf8proc_int32_t codepoint, Entry& entry) const;
+};
+
+#endif // UNACCENTTABLE_H
@@ -0,0 +1,296 @@
+/*
+ * File:   Uring.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Uring.h"
+#include <cerrno>
+#include <climits>
+
+using namespace std;
+
+#ifdef U7_IO_URING
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// The part of the vectors of a buffer that remains to be written, at its offset in the file.
+struct UringWriter::Request
+{
+    iovec * vectors;
+    size_t count;
+    uint64_t offset;
+    void * tag;
+};
+
+// The shared rings of the kernel interface, mapped in memory.
+struct UringWriter::Ring
+{
+    int fd = -1;
+    void * sq = MAP_FAILED;
+    size_t sqSize = 0;
+    void * cq = MAP_FAILED;
+    size_t cqSize = 0;
+    io_uring_sqe * sqes = (io_uring_sqe*) MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned * sqTail;
+    unsigned * sqMask;
+    unsigned * sqArray;
+    unsigned * cqHead;
+    unsigned * cqTail;
+    unsigned * cqMask;
+    io_uring_cqe * cqes;
+
+    bool setup(unsigned depth);
+    ~Ring();
+};
+
+bool UringWriter::Ring::setup(unsigned depth)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, depth, &params);
+    if (fd < 0)
+        return false;
+    sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+        sqSize = cqSize = max(sqSize, cqSize);
+    sq = mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED)
+        return false;
+    if (!single)
+    {
+        cq = mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+            return false;
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe*) mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+    char * sqBase = (char*) sq;
+    char * cqBase = (char*) (single ? sq : cq);
+    sqTail = (unsigned*) (sqBase + params.sq_off.tail);
+    sqMask = (unsigned*) (sqBase + params.sq_off.ring_mask);
+    sqArray = (unsigned*) (sqBase + params.sq_off.array);
+    cqHead = (unsigned*) (cqBase + params.cq_off.head);
+    cqTail = (unsigned*) (cqBase + params.cq_off.tail);
+    cqMask = (unsigned*) (cqBase + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*) (cqBase + params.cq_off.cqes);
+    return true;
+}
+
+UringWriter::Ring::~Ring()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqesSize);
+    if (cq != MAP_FAILED)
+        munmap(cq, cqSize);
+    if (sq != MAP_FAILED)
+        munmap(sq, sqSize);
+    if (fd >= 0)
+        close(fd);
+}
+
+unique_ptr<UringWriter> UringWriter::open(int fd, unsigned depth)
+{
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode))
+        return NULL;
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || (flags & O_APPEND))
+        return NULL;
+    const off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0)
+        return NULL;
+    unique_ptr<Ring> ring = make_unique<Ring>();
+    if (!ring->setup(depth))
+        return NULL;
+    return unique_ptr<UringWriter>(new UringWriter(fd, offset, std::move(ring), depth));
+}
+
+UringWriter::UringWriter(int fd, uint64_t offset, unique_ptr<Ring> ring, unsigned depth)
+    : m_fd(fd), m_offset(offset), m_ring(std::move(ring))
+{
+    for (unsigned i = 0; i < depth; i++)
+    {
+        m_requests.push_back(make_unique<Request>());
+        m_free.push_back(m_requests.back().get());
+    }
+}
+
+UringWriter::~UringWriter()
+{
+    // As if written with write().
+    lseek(m_fd, m_offset, SEEK_SET);
+}
+
+bool UringWriter::full() const
+{
+    return m_free.empty();
+}
+
+bool UringWriter::idle() const
+{
+    return m_inFlight == 0;
+}
+
+// Submits the next IOV_MAX vectors of a request at most.
+bool UringWriter::queue(Request * request)
+{
+    Ring& ring = *m_ring;
+    const unsigned tail = *ring.sqTail;
+    const unsigned index = tail & *ring.sqMask;
+    io_uring_sqe * sqe = &ring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = m_fd;
+    sqe->addr = (uint64_t) request->vectors;
+    sqe->len = min(request->count, (size_t) IOV_MAX);
+    sqe->off = request->offset;
+    sqe->user_data = (uint64_t) request;
+    ring.sqArray[index] = index;
+    __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+    while (syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, NULL, 0) < 0)
+    {
+        if (errno != EINTR && errno != EAGAIN)
+            return false;
+    }
+    return true;
+}
+
+bool UringWriter::submit(vector<iovec>& vectors, void * tag)
+{
+    Request * request = m_free.back();
+    request->vectors = vectors.data();
+    request->count = vectors.size();
+    request->offset = m_offset;
+    request->tag = tag;
+    for (const iovec& vector : vectors)
+        m_offset += vector.iov_len;
+    if (request->count == 0)
+    {
+        // Completed by a write of nothing.
+        vectors.push_back({NULL, 0});
+        request->vectors = vectors.data();
+        request->count = 1;
+    }
+    m_free.pop_back();
+    m_inFlight++;
+    return queue(request) || finish(request, false);
+}
+
+bool UringWriter::complete(void *& tag)
+{
+    Ring& ring = *m_ring;
+    tag = NULL;
+    while (1)
+    {
+        const unsigned head = *ring.cqHead;
+        if (head == __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE))
+        {
+            if (syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+                return false;
+            continue;
+        }
+        const io_uring_cqe cqe = ring.cqes[head & *ring.cqMask];
+        __atomic_store_n(ring.cqHead, head + 1, __ATOMIC_RELEASE);
+        Request * request = (Request*) cqe.user_data;
+        tag = request->tag;
+        if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN)
+        {
+            errno = -cqe.res;
+            return finish(request, false);
+        }
+        // A partial write is resumed where it stopped.
+        size_t written = max(cqe.res, 0);
+        request->offset += written;
+        while (request->count > 0 && written >= request->vectors->iov_len)
+        {
+            written -= request->vectors->iov_len;
+            request->vectors++;
+            request->count--;
+        }
+        if (request->count > 0)
+        {
+            if (cqe.res == 0)
+            {
+                errno = EIO;
+                return finish(request, false);
+            }
+            request->vectors->iov_base = (char*) request->vectors->iov_base + written;
+            request->vectors->iov_len -= written;
+            if (!queue(request))
+                return finish(request, false);
+            continue;
+        }
+        return finish(request, true);
+    }
+}
+
+bool UringWriter::finish(Request * request, bool written)
+{
+    m_free.push_back(request);
+    m_inFlight--;
+    return written;
+}
+
+#else
+
+struct UringWriter::Request
+{
+};
+
+struct UringWriter::Ring
+{
+};
+
+unique_ptr<UringWriter> UringWriter::open(int, unsigned)
+{
+    return NULL;
+}
+
+UringWriter::~UringWriter()
+{
+}
+
+bool UringWriter::full() const
+{
+    return true;
+}
+
+bool UringWriter::idle() const
+{
+    return true;
+}
+
+bool UringWriter::submit(vector<iovec>&, void *)
+{
+    errno = ENOSYS;
+    return false;
+}
+
+bool UringWriter::complete(void *& tag)
+{
+    tag = NULL;
+    errno = ENOSYS;
+    return false;
+}
+
+bool UringWriter::finish(Request *, bool)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * File:   Uring.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <sys/uio.h>
+
+/*
+ * Writes to a regular file through io_uring, several writes being in flight at
+ * once, each at its own offset. Built with U7_IO_URING only; the kernel
+ * interface is used directly.
+ */
+class UringWriter
+{
+public:
+    /*
+     * Null if 'fd' is not a regular file opened without O_APPEND, or if
+     * io_uring is not built in or not allowed, as in some containers. Writes
+     * start at the current offset of 'fd', which is moved past them when the
+     * writer is destroyed.
+     */
+    static std::unique_ptr<UringWriter> open(int fd, unsigned depth);
+    ~UringWriter();
+    // Whether 'depth' writes are in flight, so that complete() must be called before submit().
+    bool full() const;
+    bool idle() const;
+    /*
+     * Queues the vectors after what was queued before. They, and what they
+     * point to, must stay valid until complete() returns 'tag'. They may be
+     * altered.
+     * False on error, with errno set; the write is then abandoned.
+     */
+    bool submit(std::vector<iovec>& vectors, void * tag);
+    /*
+     * Waits until a write is complete, even if partially written at first,
+     * and sets its tag. False if it failed, with errno set; the tag is null
+     * if the ring itself failed.
+     */
+    bool complete(void *& tag);
+
+private:
+    struct Request;
+    struct Ring;
+    int m_fd;
+    uint64_t m_offset;
+    std::unique_ptr<Ring> m_ring;
+    std::vector<std::unique_ptr<Request>> m_requests;
+    std::vector<Request*> m_free;
+    unsigned m_inFlight = 0;
+
+    UringWriter(int fd, uint64_t offset, std::unique_ptr<Ring> ring, unsigned depth);
+    bool queue(Request * request);
+    // Frees a request that is done; returns 'written'.
+    bool finish(Request * request, bool written);
+};
+
+#endif // URING_H
@@ -0,0 +1,239 @@
+/*
+ * File:   Utf8.cpp
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#include "Utf8.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTF8_X86
+#endif
+
+using namespace std;
+
+int utf8SequenceLength(const char * data, size_t length)
+{
+    const unsigned char lead = data[0];
+    if (lead < 0x80)
+        return 1;
+    int continuations;
+    // The range of the second byte is narrower after some leading bytes.
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead < 0xC2)
+    {
+        return -1;
+    }
+    else if (lead < 0xE0)
+    {
+        continuations = 1;
+    }
+    else if (lead < 0xF0)
+    {
+        continuations = 2;
+        if (lead == 0xE0)
+            low = 0xA0;
+        else if (lead == 0xED) // Surrogates.
+            high = 0x9F;
+    }
+    else if (lead < 0xF5)
+    {
+        continuations = 3;
+        if (lead == 0xF0)
+            low = 0x90;
+        else if (lead == 0xF4) // Beyond U+10FFFF.
+            high = 0x8F;
+    }
+    else
+    {
+        return -1;
+    }
+    for (int i = 1; i <= continuations; i++)
+    {
+        if ((size_t) i >= length)
+            return -i;
+        const unsigned char byte = data[i];
+        if (byte < low || byte > high)
+            return -i;
+        low = 0x80;
+        high = 0xBF;
+    }
+    return continuations + 1;
+}
+
+static size_t validPrefixScalar(const char * data, size_t length)
+{
+    size_t i = 0;
+    while (i < length)
+    {
+        if ((unsigned char) data[i] < 0x80)
+        {
+            i++;
+            continue;
+        }
+        const int nb = utf8SequenceLength(data + i, length - i);
+        if (nb < 0)
+            return i;
+        i += nb;
+    }
+    return i;
+}
+
+#ifdef UTF8_X86
+// Skips blocks of ASCII characters; the others are checked one sequence at a time.
+__attribute__((target("sse2")))
+static size_t validPrefixSse2(const char * data, size_t length)
+{
+    size_t i = 0;
+    while (i + 16 <= length)
+    {
+        const unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) (data + i)));
+        if (mask == 0)
+        {
+            i += 16;
+            continue;
+        }
+        const size_t end = i + 16;
+        i += __builtin_ctz(mask);
+        while (i < end)
+        {
+            const int nb = utf8SequenceLength(data + i, length - i);
+            if (nb < 0)
+                return i;
+            i += nb;
+        }
+    }
+    return i + validPrefixScalar(data + i, length - i);
+}
+
+// 'input' preceded by the last N bytes of 'previous'.
+template <int N>
+__attribute__((target("avx2")))
+static __m256i precededBy(__m256i input, __m256i previous)
+{
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2")))
+static __m256i highNibbles(__m256i bytes)
+{
+    return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+}
+
+/*
+ * Each pair of consecutive bytes is classified by three lookups, on the high
+ * and low nibbles of the first byte and on the high nibble of the second; a
+ * bit set in all three is an error. The third and fourth bytes of a sequence
+ * are then checked to be continuation bytes, and only them.
+ */
+#define TOO_SHORT (1 << 0) // 11______ 0_______ or 11______ 11______
+#define TOO_LONG (1 << 1) // 0_______ 10______
+#define OVERLONG_3 (1 << 2) // 11100000 100_____
+#define TOO_LARGE (1 << 3) // 11110100 1001____ and above
+#define SURROGATE (1 << 4) // 11101101 101_____
+#define OVERLONG_2 (1 << 5) // 1100000_ 10______
+#define TOO_LARGE_1000 (1 << 6) // 11110101 1000____ and above
+#define OVERLONG_4 (1 << 6) // 11110000 1000____
+#define TWO_CONTINUATIONS (1 << 7) // 10______ 10______
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTINUATIONS)
+
+// The 16 entries of a lookup table, in both lanes.
+#define LOOKUP(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+__attribute__((target("avx2")))
+static size_t validPrefixAvx2(const char * data, size_t length)
+{
+    const __m256i firstHigh = LOOKUP(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        (char) TWO_CONTINUATIONS, (char) TWO_CONTINUATIONS, (char) TWO_CONTINUATIONS, (char) TWO_CONTINUATIONS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m256i firstLow = LOOKUP(
+        (char) (CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4),
+        (char) (CARRY | OVERLONG_2),
+        (char) CARRY,
+        (char) CARRY,
+        (char) (CARRY | TOO_LARGE),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char) (CARRY | TOO_LARGE | TOO_LARGE_1000));
+    const __m256i secondHigh = LOOKUP(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        (char) (TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+        (char) (TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE),
+        (char) (TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE),
+        (char) (TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE),
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    // Non-zero where a block ends with a sequence lacking continuation bytes.
+    const __m256i incompleteLimit = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char) 0xEF, (char) 0xDF, (char) 0xBF);
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i input = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i error;
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+            error = incomplete;
+            incomplete = _mm256_setzero_si256();
+        }
+        else
+        {
+            const __m256i first = precededBy<1>(input, previous);
+            const __m256i special = _mm256_and_si256(
+                _mm256_and_si256(_mm256_shuffle_epi8(firstHigh, highNibbles(first)),
+                                 _mm256_shuffle_epi8(firstLow, _mm256_and_si256(first, lowNibble))),
+                _mm256_shuffle_epi8(secondHigh, highNibbles(input)));
+            const __m256i third = _mm256_subs_epu8(precededBy<2>(input, previous), _mm256_set1_epi8(0xE0 - 0x80));
+            const __m256i fourth = _mm256_subs_epu8(precededBy<3>(input, previous), _mm256_set1_epi8(0xF0 - 0x80));
+            const __m256i continuation = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char) 0x80));
+            error = _mm256_xor_si256(continuation, special);
+            incomplete = _mm256_subs_epu8(input, incompleteLimit);
+        }
+        if (!_mm256_testz_si256(error, error))
+            break;
+        previous = input;
+    }
+    // What precedes the last leading byte before the failing block, or the tail, is valid.
+    size_t start = i;
+    for (size_t back = 1; back <= 3 && back <= i; back++)
+    {
+        const unsigned char byte = data[i - back];
+        if (byte >= 0xC0)
+            start = i - back;
+        if (byte < 0x80 || byte >= 0xC0)
+            break;
+    }
+    return start + validPrefixScalar(data + start, length - start);
+}
+#endif
+
+size_t validUtf8Prefix(const char * data, size_t length)
+{
+    if (length < 16)
+        return validPrefixScalar(data, length);
+#ifdef UTF8_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? validPrefixAvx2(data, length) : validPrefixSse2(data, length);
+#else
+    return validPrefixScalar(data, length);
+#endif
+}
@@ -0,0 +1,30 @@
+/*
+ * File:   Utf8.h
+ * Author: Saleem Edah-Tally - nmset@yandex.com
+ * License: CeCILL
+ * Copyright: Saleem Edah-Tally - © 2023
+ *
+ * Created on 17 october 2026
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <cstddef>
+
+/*
+ * Length of the well-formed UTF-8 sequence at the start of 'data', as in table
+ * 3-7 of the Unicode Standard. If it is ill-formed, minus the length of its
+ * maximal subpart: the bytes that begin a well-formed sequence without
+ * completing it, or the first byte alone.
+ */
+int utf8SequenceLength(const char * data, size_t length);
+
+/*
+ * Length of the well-formed start of 'data'; 'length' for valid UTF-8.
+ * Vectorized with AVX2, after the lookup method of Keiser and Lemire, or with
+ * SSE2 for the runs of ASCII characters only.
+ */
+size_t validUtf8Prefix(const char * data, size_t length);
+
+#endif // UTF8_H
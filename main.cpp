@@ -11,24 +11,32 @@
 #include <getopt.h>
 #include <utf8proc.h>
 #include <format>
-#include <map>
 #include <libintl.h>
+#include <cstring>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include "U7.h"
+#include "Stream.h"
+#include "Allocations.h"
+#include "ByteTables.h"
+#include "Serve.h"
+#include "Segmenter.h"
+#include "Fields.h"
+#include "Transforms.h"
+#include "Cache.h"
+#include "Stats.h"
 
 using namespace std;
 
-#define STRIP_OPTIONS_DEFAULT (UTF8PROC_IGNORE | UTF8PROC_STRIPCC | UTF8PROC_STRIPMARK | UTF8PROC_STRIPNA | UTF8PROC_DECOMPOSE | UTF8PROC_STABLE | UTF8PROC_NULLTERM)
 //https://www.labri.fr/perso/fleury/posts/programming/a-quick-gettext-tutorial.html
 #define _(STRING) gettext(STRING)
-#define _E(STRING) string(getenv("UTF8UTIL_RESULT_ONLY") != NULL ? "" : STRING)
+#define _E(STRING) string(resultOnly ? "" : STRING)
 #define _APPNAME_ "utf8util"
 #define _APPVERSION_ 2
 
-typedef map<int, string> KeyValuePair;
-// Described in utf8proc.h.
-KeyValuePair categoryDescription;
-KeyValuePair bidirectional;
-KeyValuePair decompositionType;
-KeyValuePair boundClass;
+// Labels are omitted if set; read once.
+static const bool resultOnly = getenv("UTF8UTIL_RESULT_ONLY") != NULL;
 
 string valueRepresentation(long nb, int baseHint) {
     // https://en.cppreference.com/w/cpp/utility/format/formatter
@@ -64,6 +72,49 @@ string valueRepresentation(long nb, int baseHint) {
     return formatted;
 }
 
+// Number of threads from the command line; 0 is one per core, -1 is invalid.
+int threadsArgument(const char * arg)
+{
+    char * end = NULL;
+    const long threads = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || threads < 0 || threads > 1024)
+        return -1;
+    return threads;
+}
+
+// Largest cache per thread accepted by --cache.
+#define CACHE_MAX ((size_t) 1 << 40)
+
+// A size in bytes, with an optional K, M or G suffix; 0 if invalid.
+size_t sizeArgument(const char * arg)
+{
+    char * end = NULL;
+    const long long size = strtoll(arg, &end, 10);
+    if (end == arg || size <= 0)
+        return 0;
+    int shift = 0;
+    switch (*end)
+    {
+        case 'K':
+            shift = 10;
+            end++;
+            break;
+        case 'M':
+            shift = 20;
+            end++;
+            break;
+        case 'G':
+            shift = 30;
+            end++;
+            break;
+        default:
+            break;
+    }
+    if (*end != '\0' || (size_t) size > (CACHE_MAX >> shift))
+        return 0;
+    return (size_t) size << shift;
+}
+
 void unaccentShowHelp()
 {
     string message = _("This operational mode removes character markings, control characters, default ignorable characters and unassigned codepoints from an UTF-8 input."
@@ -74,8 +125,22 @@ void unaccentShowHelp()
     "\n  -m, --mark: do not strip 'character markings'"
     "\n  -n, --na: do not strip 'unassigned codepoints'"
     "\n  -r, --recompose: output recomposed characters"
+    "\n  -s, --stream: process every line of the input, in constant memory"
+    "\n  -j, --threads: number of threads processing the stream, 0 for one per core; implies --stream"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory; implies --stream"
+    "\n  -O, --output: file to write instead of stdout; implies --stream"
+    "\n  -z, --null-data: lines of the input and of the output end with a NUL byte instead of a newline; implies --stream"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the codepoints stripped per category, of the allocations and of the time spent reading, transforming and writing; implies --stream"
+    "\n  -k, --cache: memoize the results of repeated lines or fields, in a cache of this size per thread, such as 64M; the hits, misses and evictions are printed on stderr; implies --stream"
+    "\n  -f, --fields: transform only these fields, numbered from 1, such as 2,5-7; implies --stream, on a single thread"
+    "\n  -d, --delimiter: the character separating the fields, a tab by default; \\t for a tab"
+    "\n  -q, --quoted: fields may be enclosed in double quotes, as in RFC 4180 CSV; the delimiter is then a comma by default"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
+    "\n  -w, --recursive: rewrite the files below the directories given as operands too"
     "\n  -h, --help: show this message"
-    "\n\nThe input can be piped in or read from stdin. It must be a single NULL terminated line.");
+    "\n\nThe input can be piped in or read from stdin. It must be a single NULL terminated line, unless --stream is used."
+    "\nFiles given as operands, as in 'unaccent [OPTIONS] FILE...', are rewritten in place instead, each as a stream, concurrently on --threads threads, one per core by default. A file is replaced atomically, keeping its mode, only if it changes; a summary is printed on stderr.");
     
     cout << message << endl;
 }
@@ -84,8 +149,121 @@ void normalizeShowHelp()
 {
     string message = _("This operational mode normalizes the input string according to the specified type, the default being NFC."
     "\n\n  -t, --type: one of NFC, NFD, NFKC, NFKD, NFKC_Casefold"
+    "\n  -s, --stream: process every line of the input, in constant memory"
+    "\n  -j, --threads: number of threads processing the stream, 0 for one per core; implies --stream"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory; implies --stream"
+    "\n  -O, --output: file to write instead of stdout; implies --stream"
+    "\n  -z, --null-data: lines of the input and of the output end with a NUL byte instead of a newline; implies --stream"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the codepoints stripped per category, of the allocations and of the time spent reading, transforming and writing; implies --stream"
+    "\n  -k, --cache: memoize the results of repeated lines or fields, in a cache of this size per thread, such as 64M; the hits, misses and evictions are printed on stderr; implies --stream"
+    "\n  -f, --fields: transform only these fields, numbered from 1, such as 2,5-7; implies --stream, on a single thread"
+    "\n  -d, --delimiter: the character separating the fields, a tab by default; \\t for a tab"
+    "\n  -q, --quoted: fields may be enclosed in double quotes, as in RFC 4180 CSV; the delimiter is then a comma by default"
+    "\n  -c, --check: only tell whether the whole input is normalized; if not, the exit code is 43"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
+    "\n  -w, --recursive: rewrite the files below the directories given as operands too"
+    "\n  -h, --help: show this message"
+    "\n\nThe input can be piped in or read from stdin. It must be a single NULL terminated line, unless --stream is used."
+    "\nFiles given as operands, as in 'normalize [OPTIONS] FILE...', are rewritten in place instead, each as a stream, concurrently on --threads threads, one per core by default. A file is replaced atomically, keeping its mode, only if it is not normalized already; a summary is printed on stderr.");
+    
+    cout << message << endl;
+}
+
+void caseShowHelp()
+{
+    string message = _("This operational mode maps the case of every character of an UTF-8 input, the default being lower case."
+    "\n\n  -L, --lower: lower case"
+    "\n  -U, --upper: upper case"
+    "\n  -T, --title: title case for the first letter of each word, lower case for the others"
+    "\n  -C, --fold: case folding, for caseless comparison; 'ß' is folded to 'ss'"
+    "\n  -s, --stream: process every line of the input, in constant memory"
+    "\n  -j, --threads: number of threads processing the stream, 0 for one per core; implies --stream"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory; implies --stream"
+    "\n  -O, --output: file to write instead of stdout; implies --stream"
+    "\n  -z, --null-data: lines of the input and of the output end with a NUL byte instead of a newline; implies --stream"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the allocations and of the time spent reading, transforming and writing; implies --stream"
+    "\n  -f, --fields: transform only these fields, numbered from 1, such as 2,5-7; implies --stream, on a single thread"
+    "\n  -d, --delimiter: the character separating the fields, a tab by default; \\t for a tab"
+    "\n  -q, --quoted: fields may be enclosed in double quotes, as in RFC 4180 CSV; the delimiter is then a comma by default"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
     "\n  -h, --help: show this message"
-    "\n\nThe input can be piped in or read from stdin. It must be a single NULL terminated line.");
+    "\n\nThe input can be piped in or read from stdin. It must be a single NULL terminated line, unless --stream is used."
+    "\nLower, upper and title case map one character to one; a word is a run of letters, marks, numbers and apostrophes.");
+    
+    cout << message << endl;
+}
+
+void searchKeyShowHelp()
+{
+    string message = _("This operational mode maps every line of an UTF-8 input to a key for caseless and accent-insensitive search: the result of 'normalize -t NFKC_Casefold' piped to 'unaccent -r', in a single pass."
+    "\n\n  -w, --whitespace: collapse each run of white space into a single space, and trim it at both ends of the line"
+    "\n  -s, --stream: process every line of the input, in constant memory"
+    "\n  -j, --threads: number of threads processing the stream, 0 for one per core; implies --stream; a single thread with --whitespace"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory; implies --stream"
+    "\n  -O, --output: file to write instead of stdout; implies --stream"
+    "\n  -z, --null-data: lines of the input and of the output end with a NUL byte instead of a newline; implies --stream"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the codepoints stripped per category, of the allocations and of the time spent reading, transforming and writing; implies --stream"
+    "\n  -f, --fields: transform only these fields, numbered from 1, such as 2,5-7; implies --stream, on a single thread"
+    "\n  -d, --delimiter: the character separating the fields, a tab by default; \\t for a tab"
+    "\n  -q, --quoted: fields may be enclosed in double quotes, as in RFC 4180 CSV; the delimiter is then a comma by default"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
+    "\n  -h, --help: show this message"
+    "\n\nThe input can be piped in or read from stdin. It must be a single NULL terminated line, unless --stream is used.");
+    
+    cout << message << endl;
+}
+
+void segmentShowHelp()
+{
+    string message = _("This operational mode splits every line of an UTF-8 input into grapheme clusters, the characters as perceived by a reader, and prints their number and the display width of the line, tab separated."
+    "\n\n  -w, --width: truncate each line to this number of columns instead, without splitting a grapheme cluster"
+    "\n  -z, --null-data: lines of the input and of the output end with a NUL byte instead of a newline"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the allocations and of the time spent reading, segmenting and writing"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory"
+    "\n  -O, --output: file to write instead of stdout"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
+    "\n  -h, --help: show this message"
+    "\n\nThe input is always streamed, in constant memory."
+    "\nThe width of a grapheme cluster is the largest width of its characters, as utf8proc_charwidth() tells; flags and emoji presentation sequences are two columns wide.");
+    
+    cout << message << endl;
+}
+
+void transcodeShowHelp()
+{
+    string message = _("This operational mode converts the input from one encoding to another, optionally normalizing or unaccenting it on the way."
+    "\n\nThe encodings are UTF-8, UTF-16, UTF-16LE, UTF-16BE, UTF-32, UTF-32LE, UTF-32BE and Latin-1, also named ISO-8859-1; UTF-16 and UTF-32 are big-endian with a byte order mark."
+    "\n\n  -f, --from: the encoding of the input, UTF-8 by default; a byte order mark tells the byte order of UTF-16 and UTF-32, and is skipped"
+    "\n  -t, --to: the encoding of the output, UTF-8 by default"
+    "\n  -b, --bom: write a byte order mark first, as UTF-16 and UTF-32 are"
+    "\n  -n, --normalize: normalize the text to one of NFC, NFD, NFKC, NFKD, NFKC_Casefold"
+    "\n  -u, --unaccent: remove character markings, control characters, default ignorable characters and unassigned codepoints, after --normalize"
+    "\n  -r, --recompose: output recomposed characters with --unaccent"
+    "\n  -j, --threads: number of threads normalizing or unaccenting, 0 for one per core"
+    "\n  -I, --input: file to read instead of stdin"
+    "\n  -O, --output: file to write instead of stdout"
+    "\n  -z, --null-data: lines of the input and of the output end with a NUL byte instead of a newline, for --normalize and --unaccent"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, counted in UTF-8, of the allocations and of the time spent reading, transforming and writing"
+    "\n  -D, --drop: drop each ill-formed sequence instead of replacing it with U+FFFD"
+    "\n  -h, --help: show this message"
+    "\n\nThe input is always streamed, in constant memory. The offsets of ill-formed sequences are printed on stderr, as are the number of characters replaced with '?' because Latin-1 cannot represent them."
+    "\nThe output ends as the input does; no newline is added.");
+    
+    cout << message << endl;
+}
+
+void statsShowHelp()
+{
+    string message = _("This operational mode counts the codepoints of an UTF-8 input per category, bidirectional class, decomposition type and boundclass, as the properties mode describes them, with the spans that NFC would alter and the ill-formed sequences, and prints the counts as a JSON object."
+    "\n\n  -j, --threads: number of threads counting, 0 for one per core"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory"
+    "\n  -h, --help: show this message"
+    "\n\nThe input is always streamed, in constant memory. Each thread counts on its own and the counts are added up at the end."
+    "\nA span runs from a stable starter to the next, as a base character with its combining marks; it is counted if NFC alters it.");
     
     cout << message << endl;
 }
@@ -103,8 +281,16 @@ void representationShowHelp()
     "\n  -L, --tolower: displays the codepoint as a lower-case character if existent"
     "\n  -U, --toupper: displays the codepoint as an upper-case character if existent"
     "\n  -T, --totitle: displays the codepoint as a title-case character if existent"
+    "\n  -a, --all: one row per codepoint of the whole input, with the requested columns and the character"
+    "\n  -f, --format: tsv or json, the rows of --all; tsv is the default"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory; implies --all"
+    "\n  -z, --null-data: records of the input end with a NUL byte, written after their rows instead of having a row; implies --all"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the allocations and of the time spent reading, describing and writing; implies --all"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
     "\n  -h, --help: show this message"
-    "\n\nThe input can be piped in or read from stdin. Pass in a single character for simplicity."
+    "\n\nThe input can be piped in or read from stdin. Pass in a single character for simplicity, unless --all is used."
+    "\nWith --all, tabs, newlines, carriage returns and backslashes are escaped in the tsv format; the header row is omitted if 'UTF8UTIL_RESULT_ONLY' is set."
     "\nIf the environment variable 'UTF8UTIL_RESULT_ONLY' is set, only the result is printed on stdout.");
     
     cout << message << endl;
@@ -119,29 +305,439 @@ void propertiesShowHelp()
     "\n  -d, --direction: determines the bidirectional class of a codepoint; see utf8proc.h"
     "\n  -i, --decompositiontype: determines the decomposition type of a codepoint; see utf8proc.h"
     "\n  -b, --boundclass: determines the boundclass property of a codepoint; see utf8proc.h"
+    "\n  -a, --all: one row per codepoint of the whole input, with the requested columns and the character"
+    "\n  -f, --format: tsv or json, the rows of --all; tsv is the default"
+    "\n  -I, --input: file to read instead of stdin, mapped in memory; implies --all"
+    "\n  -z, --null-data: records of the input end with a NUL byte, written after their rows instead of having a row; implies --all"
+    "\n  -S, --stats: print on stderr a JSON report of the bytes, records and codepoints read and written, of the allocations and of the time spent reading, describing and writing; implies --all"
+    "\n  -R, --repair: replace each ill-formed UTF-8 sequence with U+FFFD instead of failing, and print its offset on stderr"
+    "\n  -D, --drop: drop each ill-formed UTF-8 sequence instead of failing, and print its offset on stderr"
     "\n  -h, --help: show this message"
-    "\n\nThe input can be piped in or read from stdin. Pass in a single character for simplicity."
+    "\n\nThe input can be piped in or read from stdin. Pass in a single character for simplicity, unless --all is used."
+    "\nWith --all, tabs, newlines, carriage returns and backslashes are escaped in the tsv format; the header row is omitted if 'UTF8UTIL_RESULT_ONLY' is set."
     "\nIf the environment variable 'UTF8UTIL_RESULT_ONLY' is set, only the result is printed on stdout.");
     
     cout << message << endl;
 }
 
+void serveShowHelp()
+{
+    string message = _("This operational mode stays resident and serves requests read from stdin, or from the clients of a Unix-domain socket, in the framing of the requests."
+    "\n\nA request is a mode with its options, separated by spaces, then the input on the next lines:"
+    "\n  NUL delimited: 'ARGS\\nINPUT\\0', replied with 'STATUS\\tRESULT\\0'"
+    "\n  length prefixed: 'ARGS\\nLENGTH\\nINPUT', replied with 'STATUS LENGTH\\nRESULT'"
+    "\nThe modes are unaccent, normalize, case, searchkey, segment, representation and properties, with the options processing a single input. STATUS is the exit code of the same command and RESULT its output without the final newline, or an error message."
+    "\nrepresentation and properties reply with one row per codepoint of the whole input, as with --all; --format applies. segment replies with one row per line. --repair and --drop apply without reporting the offsets."
+    "\n\n  -l, --length: length prefixed requests; NUL delimited by default"
+    "\n  -S, --socket: Unix-domain socket to listen on, each client being served on its own thread"
+    "\n  -h, --help: show this message"
+    "\n\nRequests can be pipelined; replies are sent in order. A malformed request is replied with status 62 and ends the connection.");
+    
+    cout << message << endl;
+}
+
+// Use : --longopt=<val> -s <val>
+const option unaccentOptions[] = {
+    {"ignore", no_argument, 0, 'i'}, 
+    {"control", no_argument, 0, 'c'}, 
+    {"mark", no_argument, 0, 'm'},
+    {"na", no_argument, 0, 'n'},
+    {"recompose", no_argument, 0, 'r'},
+    {"stream", no_argument, 0, 's'},
+    {"threads", required_argument, 0, 'j'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"cache", required_argument, 0, 'k'},
+    {"input", required_argument, 0, 'I'},
+    {"output", required_argument, 0, 'O'},
+    {"fields", required_argument, 0, 'f'},
+    {"delimiter", required_argument, 0, 'd'},
+    {"quoted", no_argument, 0, 'q'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {"recursive", no_argument, 0, 'w'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option normalizeOptions[] = {
+    {"type", required_argument, 0, 't'}, 
+    {"stream", no_argument, 0, 's'},
+    {"threads", required_argument, 0, 'j'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"cache", required_argument, 0, 'k'},
+    {"input", required_argument, 0, 'I'},
+    {"output", required_argument, 0, 'O'},
+    {"check", no_argument, 0, 'c'},
+    {"fields", required_argument, 0, 'f'},
+    {"delimiter", required_argument, 0, 'd'},
+    {"quoted", no_argument, 0, 'q'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {"recursive", no_argument, 0, 'w'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option caseOptions[] = {
+    {"lower", no_argument, 0, 'L'},
+    {"upper", no_argument, 0, 'U'},
+    {"title", no_argument, 0, 'T'},
+    {"fold", no_argument, 0, 'C'},
+    {"stream", no_argument, 0, 's'},
+    {"threads", required_argument, 0, 'j'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"input", required_argument, 0, 'I'},
+    {"output", required_argument, 0, 'O'},
+    {"fields", required_argument, 0, 'f'},
+    {"delimiter", required_argument, 0, 'd'},
+    {"quoted", no_argument, 0, 'q'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option searchKeyOptions[] = {
+    {"whitespace", no_argument, 0, 'w'},
+    {"stream", no_argument, 0, 's'},
+    {"threads", required_argument, 0, 'j'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"input", required_argument, 0, 'I'},
+    {"output", required_argument, 0, 'O'},
+    {"fields", required_argument, 0, 'f'},
+    {"delimiter", required_argument, 0, 'd'},
+    {"quoted", no_argument, 0, 'q'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option segmentOptions[] = {
+    {"width", required_argument, 0, 'w'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"input", required_argument, 0, 'I'},
+    {"output", required_argument, 0, 'O'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option transcodeOptions[] = {
+    {"from", required_argument, 0, 'f'},
+    {"to", required_argument, 0, 't'},
+    {"bom", no_argument, 0, 'b'},
+    {"normalize", required_argument, 0, 'n'},
+    {"unaccent", no_argument, 0, 'u'},
+    {"recompose", no_argument, 0, 'r'},
+    {"threads", required_argument, 0, 'j'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"input", required_argument, 0, 'I'},
+    {"output", required_argument, 0, 'O'},
+    {"drop", no_argument, 0, 'D'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option statsOptions[] = {
+    {"threads", required_argument, 0, 'j'},
+    {"input", required_argument, 0, 'I'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+const option representationOptions[] = {
+    {"codepoint", no_argument, 0, 'p'}, 
+    {"utf8", no_argument, 0, 'e'},  // 'e'ight
+    {"utf16", no_argument, 0, 's'}, // 's'ixteen
+    {"binary", no_argument, 0, 'b'},
+    {"octal", no_argument, 0, 'o'},
+    {"decimal", no_argument, 0, 'd'},
+    {"xml", no_argument, 0, 'x'},
+    {"tolower", no_argument, 0, 'L'},
+    {"toupper", no_argument, 0, 'U'},
+    {"totitle", no_argument, 0, 'T'},
+    {"all", no_argument, 0, 'a'},
+    {"format", required_argument, 0, 'f'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"input", required_argument, 0, 'I'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {0}};
+
+const option propertiesOptions[] = {
+    {"islower", no_argument, 0, 'l'},
+    {"isupper", no_argument, 0, 'u'},
+    {"category", no_argument, 0, 'c'},
+    {"direction", no_argument, 0, 'd'},
+    {"decompositiontype", no_argument, 0, 'i'}, // decompos'i'tion
+    {"boundclass", no_argument, 0, 'b'},
+    {"all", no_argument, 0, 'a'},
+    {"format", required_argument, 0, 'f'},
+    {"null-data", no_argument, 0, 'z'},
+    {"stats", no_argument, 0, 'S'},
+    {"input", required_argument, 0, 'I'},
+    {"repair", no_argument, 0, 'R'},
+    {"drop", no_argument, 0, 'D'},
+    {0}};
+
+const option serveOptions[] = {
+    {"length", no_argument, 0, 'l'},
+    {"socket", required_argument, 0, 'S'},
+    {"help", no_argument, 0, 'h'},
+    {0}};
+
+void modeShowInfo()
+{
+    cout << _("A mode of operation is required: unaccent, normalize, case, searchkey, segment, transcode, stats, representation, properties, serve, about."
+     "\nPass '--help' for more information in each mode.") << endl;
+}
+
+// Largest field number accepted by --fields.
+#define FIELDS_MAX 65536
+
+// Fields from a list such as 2,5-7, numbered from 1; false if invalid.
+bool fieldsArgument(const char * arg, vector<bool>& selected)
+{
+    const char * pos = arg;
+    while (1)
+    {
+        char * end = NULL;
+        const long first = strtol(pos, &end, 10);
+        long last = first;
+        if (end == pos || first < 1 || first > FIELDS_MAX)
+            return false;
+        if (*end == '-')
+        {
+            pos = end + 1;
+            last = strtol(pos, &end, 10);
+            if (end == pos || last < first || last > FIELDS_MAX)
+                return false;
+        }
+        if (selected.size() < (size_t) last)
+            selected.resize(last, false);
+        for (long field = first; field <= last; field++)
+            selected[field - 1] = true;
+        if (*end == '\0')
+            return true;
+        if (*end != ',')
+            return false;
+        pos = end + 1;
+    }
+}
+
+// A single character, or \t for a tab; false otherwise.
+bool delimiterArgument(const char * arg, char& delimiter)
+{
+    if (strcmp(arg, "\\t") == 0)
+        delimiter = '\t';
+    else if (strlen(arg) == 1 && arg[0] != '"' && arg[0] != '\n' && arg[0] != '\r')
+        delimiter = arg[0];
+    else
+        return false;
+    return true;
+}
+
+// Streams the input, transforming only the selected fields with 'function'.
+int streamFields(const FieldTransformer::Function& function, FieldOptions fieldOptions, bool delimiterSet,
+                 const StreamOptions& streamOptions)
+{
+    if (fieldOptions.quoted && !delimiterSet)
+        fieldOptions.delimiter = ',';
+    FieldTransformer fields(fieldOptions, function);
+    const char terminator = streamOptions.delimiter;
+    return streamLinePieces([&fields, terminator](const char * data, size_t length, bool lineEnd, string& output) {
+        utf8proc_ssize_t nb = fields.feed(data, length, output);
+        if (nb >= 0 && lineEnd)
+            nb = fields.end(output, terminator);
+        return nb;
+    }, streamOptions, [&fields, terminator](string& output) {
+        return fields.finish(output, terminator);
+    });
+}
+
+// Distinguishes the options in the keys of a cache.
+int cacheTag(const u7::UnaccentOptions& options)
+{
+    return options.keepIgnorable | options.keepControl << 1 | options.keepMarks << 2
+           | options.keepUnassigned << 3 | options.recompose << 4;
+}
+
+int cacheTag(const u7::NormalizeOptions& options)
+{
+    return options.form;
+}
+
+int cacheTag(const u7::SearchKeyOptions& options)
+{
+    return options.collapseSpaces;
+}
+
+// Looks the results of 'function' up in per-thread caches, and adds them on a miss.
+FieldTransformer::Function cachedFunction(const FieldTransformer::Function& function, int tag,
+                                          const shared_ptr<ResultCaches>& caches)
+{
+    return [function, tag, caches](string_view input, string& output) -> utf8proc_ssize_t {
+        ResultCache& cache = caches->local();
+        const size_t start = output.size();
+        if (cache.find(tag, input, output))
+            return output.size() - start;
+        const utf8proc_ssize_t nb = function(input, output);
+        if (nb >= 0)
+            cache.insert(tag, input, string_view(output).substr(start));
+        return nb;
+    };
+}
+
+void showCacheStats(const ResultCaches& caches)
+{
+    const CacheStats stats = caches.stats();
+    cerr << _("Cache: ") << stats.hits << _(" hits, ") << stats.misses << _(" misses, ")
+         << stats.evictions << _(" evictions");
+    const uint64_t lookups = stats.hits + stats.misses;
+    if (lookups)
+        cerr << " (" << (stats.hits * 100 / lookups) << _("% hits)");
+    cerr << endl;
+}
+
+/*
+ * With --stats, counts and times the stream of a mode, and prints the report
+ * on stderr when it goes out of scope.
+ */
+class StatsReport
+{
+public:
+    // 'categories' is set for the modes that may strip codepoints.
+    StatsReport(bool enabled, const char * mode, bool categories, StreamOptions& streamOptions)
+        : m_mode(mode)
+    {
+        if (!enabled)
+            return;
+        startAllocationCount();
+        m_stats = make_unique<StreamStats>(streamOptions.delimiter);
+        m_stats->categories = categories;
+        streamOptions.stats = m_stats.get();
+    }
+    ~StatsReport()
+    {
+        if (m_stats)
+            cerr << m_stats->report(m_mode) << endl;
+    }
+
+private:
+    const char * m_mode;
+    unique_ptr<StreamStats> m_stats;
+};
+
+// Files to rewrite in place, given as operands, instead of the input.
+struct FileOperands
+{
+    vector<string> paths;
+    bool recursive = false;
+};
+
+/*
+ * Collects the operands that getopt_long() left, from 'optind'. False if they
+ * come with an option of a single input, 'single', or if there are none with
+ * --recursive.
+ */
+bool fileOperands(int argc, char ** argv, bool recursive, bool single, FileOperands& files)
+{
+    for (int i = optind; i < argc; i++)
+        files.paths.emplace_back(argv[i]);
+    files.recursive = recursive;
+    if (files.paths.empty() && recursive)
+    {
+        cout << _("--recursive requires files or directories.") << endl;
+        return false;
+    }
+    if (!files.paths.empty() && single)
+    {
+        cout << _("Files to rewrite cannot be combined with --input, --output, --fields, --stats or --check.") << endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Streams the input through 'function', on the selected fields only if any,
+ * with per-thread caches of 'cacheSize' bytes if not 0. Rewrites 'files'
+ * instead, if any.
+ */
+template <typename Options>
+int streamOperation(FieldTransformer::Function function, const Options& options, size_t cacheSize,
+                    const FieldOptions& fieldOptions, bool delimiterSet, const StreamOptions& streamOptions,
+                    const FileOperands& files = FileOperands())
+{
+    shared_ptr<ResultCaches> caches;
+    if (cacheSize)
+    {
+        caches = make_shared<ResultCaches>(cacheSize);
+        function = cachedFunction(function, cacheTag(options), caches);
+    }
+    int ret;
+    if (!fieldOptions.selected.empty())
+    {
+        ret = streamFields(function, fieldOptions, delimiterSet, streamOptions);
+    }
+    else
+    {
+        Transform transform;
+        transform.function = [function](const char * data, size_t length, string& output) {
+            return function(string_view(data, length), output);
+        };
+        transform.unchanged = [options](const char * data, size_t length) {
+            return u7::unchanged(string_view(data, length), options);
+        };
+        if (files.paths.empty())
+            ret = streamTransform(transform, streamOptions);
+        else
+            ret = rewriteFiles(files.paths, files.recursive, transform, streamOptions);
+    }
+    if (caches)
+        showCacheStats(*caches);
+    return ret;
+}
+
+// Applies one of the -i, -c, -m, -n and -r options of unaccent.
+void unaccentFlag(int opt, u7::UnaccentOptions& options)
+{
+    switch (opt) {
+        case 'i':
+            options.keepIgnorable = !options.keepIgnorable;
+            break;
+        case 'c':
+            options.keepControl = !options.keepControl;
+            break;
+        case 'm':
+            options.keepMarks = !options.keepMarks;
+            break;
+        case 'n':
+            options.keepUnassigned = !options.keepUnassigned;
+            break;
+        case 'r':
+            options.recompose = true;
+            break;
+        default:
+            break;
+    }
+}
+
 int unaccent(int argc, char **argv) {
     string input;
-    int options  = STRIP_OPTIONS_DEFAULT;
-    
-    // Use : --longopt=<val> -s <val>
-    option longopts[] = {
-        {"ignore", no_argument, 0, 'i'}, 
-        {"control", no_argument, 0, 'c'}, 
-        {"mark", no_argument, 0, 'm'},
-        {"na", no_argument, 0, 'n'},
-        {"recompose", no_argument, 0, 'r'},
-        {"help", no_argument, 0, 'h'},
-        {0}};
-        
+    u7::UnaccentOptions options;
+    bool stream = false;
+    bool showStats = false;
+    StreamOptions streamOptions;
+    FieldOptions fieldOptions;
+    bool delimiterSet = false;
+    size_t cacheSize = 0;
+    bool threadsSet = false;
+    bool recursive = false;
+    
     while (1) {
-        const int opt = getopt_long(argc, argv, "icmnrh", longopts, 0);
+        const int opt = getopt_long(argc, argv, "icmnrsj:I:O:zSk:f:d:qRDwh", unaccentOptions, 0);
         
         if (opt == -1) {
             break;
@@ -149,22 +745,80 @@ int unaccent(int argc, char **argv) {
         
         switch (opt) {
             case 'i':
-                options ^= UTF8PROC_IGNORE;
-                break;
             case 'c':
-                options ^= UTF8PROC_STRIPCC;
-                break;
             case 'm':
-                options ^= UTF8PROC_STRIPMARK;
-                break;
             case 'n':
-                options ^= UTF8PROC_STRIPNA;
-                break;
             case 'r':
-                // Interestingly, UTF8PROC_COMPOSE gives the same result as UTF8PROC_DECOMPOSE.
-                // Probably the options mean : decompose, strip, compose ?
-                options ^= UTF8PROC_DECOMPOSE;
-                options |= UTF8PROC_COMPOSE;
+                unaccentFlag(opt, options);
+                break;
+            case 's':
+                stream = true;
+                break;
+            case 'j':
+            {
+                const int threads = threadsArgument(optarg);
+                if (threads < 0)
+                {
+                    cout << _("Invalid number of threads.") << endl;
+                    return 31;
+                }
+                streamOptions.threads = threads;
+                threadsSet = true;
+                stream = true;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                stream = true;
+                break;
+            case 'O':
+                streamOptions.output = optarg;
+                stream = true;
+                break;
+            case 'k':
+                cacheSize = sizeArgument(optarg);
+                if (cacheSize == 0)
+                {
+                    cout << _("Invalid cache size.") << endl;
+                    return 33;
+                }
+                stream = true;
+                break;
+            case 'f':
+                if (!fieldsArgument(optarg, fieldOptions.selected))
+                {
+                    cout << _("Invalid field list.") << endl;
+                    return 32;
+                }
+                stream = true;
+                break;
+            case 'd':
+                if (!delimiterArgument(optarg, fieldOptions.delimiter))
+                {
+                    cout << _("Invalid delimiter.") << endl;
+                    return 32;
+                }
+                delimiterSet = true;
+                break;
+            case 'q':
+                fieldOptions.quoted = true;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                stream = true;
+                break;
+            case 'S':
+                showStats = true;
+                stream = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case 'w':
+                recursive = true;
                 break;
             case 'h':
                 unaccentShowHelp();
@@ -172,32 +826,44 @@ int unaccent(int argc, char **argv) {
             case '?':
                 return 30; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
             default:
-                options  = STRIP_OPTIONS_DEFAULT;
+                options = u7::UnaccentOptions();
                 break;
         }
     }
     
+    FileOperands files;
+    const bool single = !streamOptions.input.empty() || !streamOptions.output.empty()
+                        || !fieldOptions.selected.empty() || showStats;
+    if (!fileOperands(argc, argv, recursive, single, files))
+        return 34;
+    if (!files.paths.empty() && !threadsSet)
+        streamOptions.threads = 0;
+    
+    if (stream || !files.paths.empty())
+    {
+        StatsReport report(showStats, "unaccent", true, streamOptions);
+        const u7::Unaccenter unaccenter(options);
+        return streamOperation([unaccenter](string_view input, string& output) {
+            return unaccenter(input, output);
+        }, options, cacheSize, fieldOptions, delimiterSet, streamOptions, files);
+    }
+    
     //string fragment;
     // while (cin >> fragment)
     //     input += fragment + " ";
     // input.pop_back();
     std::getline(cin, input);
-    utf8proc_uint8_t * result;
-    utf8proc_ssize_t nb = utf8proc_map((const utf8proc_uint8_t *) input.data(),
-                                        0, // Without UTF8PROC_NULLTERM, is number of bytes to process from input.
-                                        &result,
-                                        utf8proc_option_t (options)
-    );
+    repairInput(input, streamOptions.repair);
+    // Only what precedes a NULL byte is processed, as with UTF8PROC_NULLTERM.
+    string result;
+    utf8proc_ssize_t nb = u7::unaccent(string_view(input.c_str()), options, result);
     if (nb < 0) // an error occured
     {
         cout << utf8proc_errmsg(nb) << endl;
-        if (result)
-            free((void*) result);
         return nb * -1;
     }
     
-    cout << (const char*) result << endl;
-    free((void*) result);
+    cout << result << endl;
     
     return 0;
 }
@@ -206,71 +872,776 @@ int normalize(int argc, char ** argv)
 {
     string input;
     string type("NFC");
+    bool stream = false;
+    bool showStats = false;
+    bool check = false;
+    StreamOptions streamOptions;
+    FieldOptions fieldOptions;
+    bool delimiterSet = false;
+    size_t cacheSize = 0;
+    bool threadsSet = false;
+    bool recursive = false;
+    
+    while (1) {
+        const int opt = getopt_long(argc, argv, "t:sj:I:O:zSk:f:d:qcRDwh", normalizeOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 't':
+                type = optarg;
+                break;
+            case 's':
+                stream = true;
+                break;
+            case 'j':
+            {
+                const int threads = threadsArgument(optarg);
+                if (threads < 0)
+                {
+                    cout << _("Invalid number of threads.") << endl;
+                    return 42;
+                }
+                streamOptions.threads = threads;
+                threadsSet = true;
+                stream = true;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                stream = true;
+                break;
+            case 'O':
+                streamOptions.output = optarg;
+                stream = true;
+                break;
+            case 'k':
+                cacheSize = sizeArgument(optarg);
+                if (cacheSize == 0)
+                {
+                    cout << _("Invalid cache size.") << endl;
+                    return 45;
+                }
+                stream = true;
+                break;
+            case 'f':
+                if (!fieldsArgument(optarg, fieldOptions.selected))
+                {
+                    cout << _("Invalid field list.") << endl;
+                    return 44;
+                }
+                stream = true;
+                break;
+            case 'd':
+                if (!delimiterArgument(optarg, fieldOptions.delimiter))
+                {
+                    cout << _("Invalid delimiter.") << endl;
+                    return 44;
+                }
+                delimiterSet = true;
+                break;
+            case 'q':
+                fieldOptions.quoted = true;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                stream = true;
+                break;
+            case 'S':
+                showStats = true;
+                stream = true;
+                break;
+            case 'c':
+                check = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case 'w':
+                recursive = true;
+                break;
+            case 'h':
+                normalizeShowHelp();
+                return 0;
+            case '?':
+                return 40; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                type = "NFC";
+                break;
+        }
+    }
+    
+    u7::NormalizeOptions options;
+    if (!u7::normalizationForm(type, options.form))
+    {
+        cout << _("Unknown type; valid types are NFC, NFD, NFKC, NFKD and NFKC_Casefold.") << endl;
+        return 41;
+    }
+    
+    FileOperands files;
+    const bool single = !streamOptions.input.empty() || !streamOptions.output.empty()
+                        || !fieldOptions.selected.empty() || showStats || check;
+    if (!fileOperands(argc, argv, recursive, single, files))
+        return 46;
+    if (!files.paths.empty() && !threadsSet)
+        streamOptions.threads = 0;
     
-    // Use : --longopt=<val> -s <val>
-    option longopts[] = {
-        {"type", required_argument, 0, 't'}, 
-        {"help", no_argument, 0, 'h'},
-        {0}};
+    // Long lines are cut where the form allows.
+    streamOptions.boundary = [options](utf8proc_int32_t codepoint) { return u7::boundaryBefore(codepoint, options); };
+    StatsReport report(showStats, "normalize", !check, streamOptions);
+    
+    if (check)
+    {
+        bool normalized = true;
+        const int ret = streamLines([&](const char * data, size_t length) {
+            normalized = u7::isNormalized(string_view(data, length), options);
+            return normalized;
+        }, streamOptions);
+        if (ret)
+            return ret;
+        cout << _E(_("Normalized: ")) << normalized << endl;
+        return normalized ? 0 : 43;
+    }
+    
+    if (stream || !files.paths.empty())
+    {
+        return streamOperation([options](string_view input, string& output) {
+            return u7::normalize(input, options, output);
+        }, options, cacheSize, fieldOptions, delimiterSet, streamOptions, files);
+    }
+    
+    std::getline(cin, input);
+    repairInput(input, streamOptions.repair);
+    // Only what precedes a NULL byte is processed, as with UTF8PROC_NULLTERM.
+    const string_view line(input.c_str());
+    if (u7::unchanged(line, options))
+    {
+        cout << line << endl;
+        return 0;
+    }
+    string result;
+    utf8proc_ssize_t nb = u7::normalize(line, options, result);
+    if (nb < 0) // an error occured
+    {
+        cout << utf8proc_errmsg(nb) << endl;
+        return nb * -1;
+    }
+    
+    cout << result << endl;
+    
+    return 0;
+}
+
+// Applies one of the -L, -U, -T and -C options of case; the last one wins.
+void caseFlag(int opt, u7::CaseOptions& options)
+{
+    const char * const flags = "LUTC"; // In the order of u7::CaseMapping.
+    const char * flag = strchr(flags, opt);
+    if (flag)
+        options.mapping = u7::CaseMapping(flag - flags);
+}
+
+int letterCase(int argc, char ** argv)
+{
+    string input;
+    u7::CaseOptions options;
+    bool stream = false;
+    bool showStats = false;
+    StreamOptions streamOptions;
+    FieldOptions fieldOptions;
+    bool delimiterSet = false;
+    
+    while (1) {
+        const int opt = getopt_long(argc, argv, "LUTCsj:I:O:zSf:d:qRDh", caseOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'L':
+            case 'U':
+            case 'T':
+            case 'C':
+                caseFlag(opt, options);
+                break;
+            case 's':
+                stream = true;
+                break;
+            case 'j':
+            {
+                const int threads = threadsArgument(optarg);
+                if (threads < 0)
+                {
+                    cout << _("Invalid number of threads.") << endl;
+                    return 71;
+                }
+                streamOptions.threads = threads;
+                stream = true;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                stream = true;
+                break;
+            case 'O':
+                streamOptions.output = optarg;
+                stream = true;
+                break;
+            case 'f':
+                if (!fieldsArgument(optarg, fieldOptions.selected))
+                {
+                    cout << _("Invalid field list.") << endl;
+                    return 72;
+                }
+                stream = true;
+                break;
+            case 'd':
+                if (!delimiterArgument(optarg, fieldOptions.delimiter))
+                {
+                    cout << _("Invalid delimiter.") << endl;
+                    return 72;
+                }
+                delimiterSet = true;
+                break;
+            case 'q':
+                fieldOptions.quoted = true;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                stream = true;
+                break;
+            case 'S':
+                showStats = true;
+                stream = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case 'h':
+                caseShowHelp();
+                return 0;
+            case '?':
+                return 70; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                break;
+        }
+    }
+    
+    streamOptions.boundary = [options](utf8proc_int32_t codepoint) { return u7::boundaryBefore(codepoint, options); };
+    StatsReport report(showStats, "case", false, streamOptions);
+    
+    if (!fieldOptions.selected.empty())
+    {
+        return streamFields([options](string_view field, string& output) {
+            return u7::mapCase(field, options, output);
+        }, fieldOptions, delimiterSet, streamOptions);
+    }
+    
+    if (stream)
+    {
+        Transform transform;
+        transform.function = [options](const char * data, size_t length, string& output) {
+            return u7::mapCase(string_view(data, length), options, output);
+        };
+        transform.wholeChunks = true;
+        return streamTransform(transform, streamOptions);
+    }
+    
+    std::getline(cin, input);
+    repairInput(input, streamOptions.repair);
+    // Only what precedes a NULL byte is processed, as with the other modes.
+    string result;
+    utf8proc_ssize_t nb = u7::mapCase(string_view(input.c_str()), options, result);
+    if (nb < 0) // an error occured
+    {
+        cout << utf8proc_errmsg(nb) << endl;
+        return nb * -1;
+    }
+    
+    cout << result << endl;
+    
+    return 0;
+}
+
+// Number of columns from the command line; -1 is invalid.
+long widthArgument(const char * arg)
+{
+    char * end = NULL;
+    const long width = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || width <= 0)
+        return -1;
+    return width;
+}
+
+int searchKey(int argc, char ** argv)
+{
+    string input;
+    u7::SearchKeyOptions options;
+    bool stream = false;
+    bool showStats = false;
+    StreamOptions streamOptions;
+    FieldOptions fieldOptions;
+    bool delimiterSet = false;
+    
+    while (1) {
+        const int opt = getopt_long(argc, argv, "wsj:I:O:zSf:d:qRDh", searchKeyOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'w':
+                options.collapseSpaces = true;
+                break;
+            case 's':
+                stream = true;
+                break;
+            case 'j':
+            {
+                const int threads = threadsArgument(optarg);
+                if (threads < 0)
+                {
+                    cout << _("Invalid number of threads.") << endl;
+                    return 91;
+                }
+                streamOptions.threads = threads;
+                stream = true;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                stream = true;
+                break;
+            case 'O':
+                streamOptions.output = optarg;
+                stream = true;
+                break;
+            case 'f':
+                if (!fieldsArgument(optarg, fieldOptions.selected))
+                {
+                    cout << _("Invalid field list.") << endl;
+                    return 92;
+                }
+                stream = true;
+                break;
+            case 'd':
+                if (!delimiterArgument(optarg, fieldOptions.delimiter))
+                {
+                    cout << _("Invalid delimiter.") << endl;
+                    return 92;
+                }
+                delimiterSet = true;
+                break;
+            case 'q':
+                fieldOptions.quoted = true;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                stream = true;
+                break;
+            case 'S':
+                showStats = true;
+                stream = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case 'h':
+                searchKeyShowHelp();
+                return 0;
+            case '?':
+                return 90; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                break;
+        }
+    }
+    
+    streamOptions.boundary = [options](utf8proc_int32_t codepoint) { return u7::boundaryBefore(codepoint, options); };
+    StatsReport report(showStats, "searchkey", true, streamOptions);
+    
+    if (stream && options.collapseSpaces && fieldOptions.selected.empty())
+    {
+        // Runs of white space may span the pieces of a long line.
+        const u7::SearchKeyOptions pieceOptions;
+        const char terminator = streamOptions.delimiter;
+        SpaceRun run;
+        string key;
+        return streamLinePieces([&](const char * data, size_t length, bool lineEnd, string& output) {
+            key.clear();
+            const utf8proc_ssize_t nb = u7::searchKey(string_view(data, length), pieceOptions, key);
+            if (nb < 0)
+                return nb;
+            appendCollapsed(key.data(), key.size(), run, output);
+            if (lineEnd)
+            {
+                output.push_back(terminator);
+                run = SpaceRun();
+            }
+            return (utf8proc_ssize_t) 0;
+        }, streamOptions);
+    }
+    
+    if (stream)
+    {
+        return streamOperation([options](string_view input, string& output) {
+            return u7::searchKey(input, options, output);
+        }, options, 0, fieldOptions, delimiterSet, streamOptions);
+    }
+    
+    std::getline(cin, input);
+    repairInput(input, streamOptions.repair);
+    // Only what precedes a NULL byte is processed, as with the other modes.
+    string result;
+    utf8proc_ssize_t nb = u7::searchKey(string_view(input.c_str()), options, result);
+    if (nb < 0) // an error occured
+    {
+        cout << utf8proc_errmsg(nb) << endl;
+        return nb * -1;
+    }
+    
+    cout << result << endl;
+    
+    return 0;
+}
+
+int segment(int argc, char ** argv)
+{
+    u7::SegmentOptions options;
+    StreamOptions streamOptions;
+    bool showStats = false;
+    
+    while (1) {
+        const int opt = getopt_long(argc, argv, "w:I:O:zSRDh", segmentOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'w':
+            {
+                const long width = widthArgument(optarg);
+                if (width < 0)
+                {
+                    cout << _("Invalid width.") << endl;
+                    return 81;
+                }
+                options.width = width;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                break;
+            case 'O':
+                streamOptions.output = optarg;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                break;
+            case 'S':
+                showStats = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case 'h':
+                segmentShowHelp();
+                return 0;
+            case '?':
+                return 80; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                break;
+        }
+    }
+    
+    StatsReport report(showStats, "segment", false, streamOptions);
+    Segmenter segmenter(options.width);
+    const char terminator = streamOptions.delimiter;
+    return streamLinePieces([&segmenter, terminator](const char * data, size_t length, bool lineEnd, string& output) {
+        const utf8proc_ssize_t nb = segmenter.feed(data, length, output);
+        if (nb >= 0 && lineEnd)
+            segmenter.end(output, terminator);
+        return nb;
+    }, streamOptions);
+}
+
+int transcode(int argc, char ** argv)
+{
+    StreamOptions streamOptions;
+    streamOptions.transcode = true;
+    streamOptions.repair = REPAIR_REPLACE;
+    bool normalize = false;
+    string type;
+    bool unaccent = false;
+    u7::UnaccentOptions unaccentOptions;
+    bool byteOrderMark = false;
+    bool showStats = false;
     
     while (1) {
-        const int opt = getopt_long(argc, argv, "t:h", longopts, 0);
+        const int opt = getopt_long(argc, argv, "f:t:bn:urj:I:O:zSDh", transcodeOptions, 0);
         
         if (opt == -1) {
             break;
         }
         
         switch (opt) {
+            case 'f':
+                if (!encodingName(optarg, streamOptions.from))
+                {
+                    cout << _("Unknown encoding; valid encodings are UTF-8, UTF-16, UTF-16LE, UTF-16BE, UTF-32, UTF-32LE, UTF-32BE and Latin-1.") << endl;
+                    return 101;
+                }
+                break;
             case 't':
+                if (!encodingName(optarg, streamOptions.to))
+                {
+                    cout << _("Unknown encoding; valid encodings are UTF-8, UTF-16, UTF-16LE, UTF-16BE, UTF-32, UTF-32LE, UTF-32BE and Latin-1.") << endl;
+                    return 101;
+                }
+                break;
+            case 'b':
+                byteOrderMark = true;
+                break;
+            case 'n':
+                normalize = true;
                 type = optarg;
                 break;
+            case 'u':
+                unaccent = true;
+                break;
+            case 'r':
+                unaccentOptions.recompose = true;
+                break;
+            case 'j':
+            {
+                const int threads = threadsArgument(optarg);
+                if (threads < 0)
+                {
+                    cout << _("Invalid number of threads.") << endl;
+                    return 102;
+                }
+                streamOptions.threads = threads;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                break;
+            case 'O':
+                streamOptions.output = optarg;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                break;
+            case 'S':
+                showStats = true;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case 'h':
+                transcodeShowHelp();
+                return 0;
+            case '?':
+                return 100; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                break;
+        }
+    }
+    
+    // UTF-16 and UTF-32 are written with one anyway.
+    streamOptions.to.byteOrderMark |= byteOrderMark;
+    u7::NormalizeOptions normalizeOptions;
+    if (normalize && !u7::normalizationForm(type, normalizeOptions.form))
+    {
+        cout << _("Unknown type; valid types are NFC, NFD, NFKC, NFKD and NFKC_Casefold.") << endl;
+        return 103;
+    }
+    
+    // What normalization allows to cut, unaccent does too.
+    if (normalize)
+    {
+        streamOptions.boundary = [normalizeOptions](utf8proc_int32_t codepoint) {
+            return u7::boundaryBefore(codepoint, normalizeOptions);
+        };
+    }
+    StatsReport report(showStats, "transcode", unaccent, streamOptions);
+    Transform transform;
+    // The output ends as the input does.
+    transform.terminateLast = false;
+    if (!normalize && !unaccent)
+    {
+        // The stream is decoded and encoded as it is read and written.
+        transform.wholeChunks = true;
+        transform.function = [](const char * data, size_t length, string& output) {
+            output.append(data, length);
+            return (utf8proc_ssize_t) 0;
+        };
+        streamOptions.threads = 1;
+    }
+    else if (!unaccent)
+    {
+        transform.function = [normalizeOptions](const char * data, size_t length, string& output) {
+            return u7::normalize(string_view(data, length), normalizeOptions, output);
+        };
+        transform.unchanged = [normalizeOptions](const char * data, size_t length) {
+            return u7::unchanged(string_view(data, length), normalizeOptions);
+        };
+    }
+    else if (!normalize)
+    {
+        const u7::Unaccenter unaccenter(unaccentOptions);
+        transform.function = [unaccenter](const char * data, size_t length, string& output) {
+            return unaccenter(string_view(data, length), output);
+        };
+        transform.unchanged = [unaccentOptions](const char * data, size_t length) {
+            return u7::unchanged(string_view(data, length), unaccentOptions);
+        };
+    }
+    else
+    {
+        const u7::Unaccenter unaccenter(unaccentOptions);
+        transform.function = [normalizeOptions, unaccenter](const char * data, size_t length, string& output) {
+            thread_local string normalized;
+            normalized.clear();
+            const utf8proc_ssize_t nb = u7::normalize(string_view(data, length), normalizeOptions, normalized);
+            if (nb < 0)
+                return nb;
+            return unaccenter(normalized, output);
+        };
+    }
+    return streamTransform(transform, streamOptions);
+}
+
+int stats(int argc, char ** argv)
+{
+    StreamOptions streamOptions;
+    
+    while (1) {
+        const int opt = getopt_long(argc, argv, "j:I:h", statsOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'j':
+            {
+                const int threads = threadsArgument(optarg);
+                if (threads < 0)
+                {
+                    cout << _("Invalid number of threads.") << endl;
+                    return 111;
+                }
+                streamOptions.threads = threads;
+            }
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                break;
             case 'h':
-                normalizeShowHelp();
+                statsShowHelp();
                 return 0;
             case '?':
-                return 40; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+                return 110; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
             default:
-                type = "NFC";
                 break;
         }
     }
     
-    std::getline(cin, input);
-    utf8proc_uint8_t * result = NULL;
-    
-    if (type == "NFC")
-    {
-        result = utf8proc_NFC((const utf8proc_uint8_t*) input.c_str());
-    }
-    else if (type == "NFD")
+    // One census per worker, added up once the input is read.
+    vector<u7::PropertyCensus> censuses(streamWorkers(streamOptions));
+    const int ret = streamChunks([&censuses](string_view chunk, unsigned worker) {
+        u7::countProperties(chunk, censuses[worker]);
+    }, streamOptions);
+    if (ret)
+        return ret;
+    for (size_t i = 1; i < censuses.size(); i++)
+        censuses[0].add(censuses[i]);
+    string report;
+    u7::censusReport(censuses[0], report);
+    cout << report << endl;
+    return 0;
+}
+
+// Returns 52 on an unknown format.
+int formatArgument(const string& format, u7::RowFormat& rowFormat)
+{
+    if (format == "tsv")
     {
-        result = utf8proc_NFD((const utf8proc_uint8_t*) input.c_str());
+        rowFormat = u7::ROW_TSV;
     }
-    else if (type == "NFKC")
+    else if (format == "json")
     {
-        result = utf8proc_NFKC((const utf8proc_uint8_t*) input.c_str());
+        rowFormat = u7::ROW_JSON;
     }
-    else if (type == "NFKD")
+    else
     {
-        result = utf8proc_NFKD((const utf8proc_uint8_t*) input.c_str());
+        cout << _("Unknown format: ") << format << endl;
+        return 52;
     }
-    else if (type == "NFKC_Casefold")
+    return 0;
+}
+
+// Options selecting the columns of representation and properties, in the order of u7::Representation and u7::Property.
+#define REPRESENTATION_COLUMNS "pesbodxLUT"
+#define PROPERTIES_COLUMNS "lucdib"
+
+template <typename Column>
+vector<Column> columns(const vector<int>& selectors, const char * columnOptions)
+{
+    vector<Column> result;
+    for (int selector : selectors)
     {
-        result = utf8proc_NFKC_Casefold((const utf8proc_uint8_t*) input.c_str());
+        const char * column = strchr(columnOptions, selector);
+        if (column)
+            result.push_back(Column(column - columnOptions));
     }
-    else
+    return result;
+}
+
+// Writes one row per codepoint of the input, after a header row in the TSV format.
+template <typename Options>
+int codepointRows(const Options& options, const StreamOptions& streamOptions)
+{
+    if (options.format == u7::ROW_TSV && !resultOnly)
     {
-        cout << _("Unknown type; valid types are NFC, NFD, NFKC, NFKD and NFKC_Casefold.") << endl;
-        return 41;
+        string header;
+        u7::header(options, header);
+        cout << header << flush;
     }
-    
-    if (result)
+    const bool records = streamOptions.delimiter == '\0';
+    bool recordOpen = false;
+    const int ret = streamCodepoints([&](utf8proc_int32_t codepoint, const char *, size_t, string& output)
     {
-        cout << (const char*) result << endl;
-        free((void*) result);
-    }
-    
-    return 0;
+        // A NUL ending a record follows its rows.
+        if (records && codepoint == 0)
+        {
+            output.push_back('\0');
+            recordOpen = false;
+            return;
+        }
+        u7::row(codepoint, options, output);
+        recordOpen = true;
+    }, streamOptions);
+    if (ret == 0 && recordOpen)
+        cout << '\0' << flush;
+    return ret;
 }
 
 int representation(int argc, char ** argv)
@@ -285,9 +1656,66 @@ int representation(int argc, char ** argv)
         }
     }
     
+    vector<int> selectors;
+    bool all = false;
+    bool showStats = false;
+    string format("tsv");
+    StreamOptions streamOptions;
+    while (1) {
+        const int opt = getopt_long(argc, argv, "pesbodxLUTaf:I:zSRD", representationOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'a':
+                all = true;
+                break;
+            case 'f':
+                format = optarg;
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                all = true;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                all = true;
+                break;
+            case 'S':
+                showStats = true;
+                all = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case '?':
+                return 50; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                selectors.push_back(opt);
+                break;
+        }
+    }
+    
+    u7::RepresentationOptions rowOptions;
+    const int formatStatus = formatArgument(format, rowOptions.format);
+    if (formatStatus)
+        return formatStatus;
+    if (all)
+    {
+        StatsReport report(showStats, "representation", false, streamOptions);
+        rowOptions.columns = columns<u7::Representation>(selectors, REPRESENTATION_COLUMNS);
+        return codepointRows(rowOptions, streamOptions);
+    }
+    
     utf8proc_int32_t codepoint = 0;
     string input;
     cin >> input;
+    repairInput(input, streamOptions.repair);
     const utf8proc_uint8_t * inputArray = (const utf8proc_uint8_t *) input.c_str();
     // This stops at the first codepoint; with 'عَ', the first retrieved codepoint is 'ع'.
     utf8proc_ssize_t nb = utf8proc_iterate(&inputArray[0], -1, &codepoint);
@@ -305,27 +1733,9 @@ int representation(int argc, char ** argv)
     }
     firstCharArray[nbOfBytesInFirstChar] = '\0';
     
-    option longopts[] = {
-        {"codepoint", no_argument, 0, 'p'}, 
-        {"utf8", no_argument, 0, 'e'},  // 'e'ight
-        {"utf16", no_argument, 0, 's'}, // 's'ixteen
-        {"binary", no_argument, 0, 'b'},
-        {"octal", no_argument, 0, 'o'},
-        {"decimal", no_argument, 0, 'd'},
-        {"xml", no_argument, 0, 'x'},
-        {"tolower", no_argument, 0, 'L'},
-        {"toupper", no_argument, 0, 'U'},
-        {"totitle", no_argument, 0, 'T'},
-        {0}};
-        
-    while (1) {
-        const int opt = getopt_long(argc, argv, "pesbodxLUT", longopts, 0);
-        
-        if (opt == -1) {
-            break;
-        }
-        
-        switch (opt) {
+    for (int selector : selectors)
+    {
+        switch (selector) {
             case 'p':
                 cout << _E(_("Codepoint: ")) << valueRepresentation(codepoint, 'U') << endl;
                 break;
@@ -333,34 +1743,22 @@ int representation(int argc, char ** argv)
                 cout << _E("UTF-8: ");
                 for (uint i = 0; i < nbOfBytesInFirstChar; i++)
                 {
-                    cout << valueRepresentation(firstCharArray[i], 16) << " ";
+                    cout << byteRepresentation(firstCharArray[i], 16) << " ";
                 }
                 cout << endl;
                 break;
             case 's':
-                // https://en.wikipedia.org/wiki/UTF-16
-                cout << _E("UTF-16: ");
-                if (codepoint < 0xFFFF) // 2 bytes only
-                {
-                    cout << valueRepresentation(codepoint, 17);
-                }
-                else // 4 bytes
-                {
-                    utf8proc_int32_t intermediate = codepoint - 0x10000;
-                    utf8proc_int32_t shifted = intermediate >> 10; // Divide by 0x400 (1024)(2^10)
-                    utf8proc_int32_t highSurrogate = shifted +  0xD800;
-                    utf8proc_int32_t lowTenBits = intermediate % 0x400; // Same result with (intermediate & 1023)
-                    utf8proc_int32_t lowSurrogate = lowTenBits + 0xDC00;
-                    cout << valueRepresentation(highSurrogate, 17) << " ";
-                    cout << valueRepresentation(lowSurrogate, 17);
-                }
-                cout << endl;
+            {
+                string surrogates;
+                u7::representation(codepoint, u7::UTF16, surrogates);
+                cout << _E("UTF-16: ") << surrogates << endl;
+            }
                 break;
             case 'b':
                 cout << _E(_("Binary: "));
                 for (uint i = 0; i < nbOfBytesInFirstChar; i++)
                 {
-                    cout << valueRepresentation(firstCharArray[i], 2) << " ";
+                    cout << byteRepresentation(firstCharArray[i], 2) << " ";
                 }
                 cout << endl;
                 break;
@@ -368,7 +1766,7 @@ int representation(int argc, char ** argv)
                 cout << _E(_("Octal: "));
                 for (uint i = 0; i < nbOfBytesInFirstChar; i++)
                 {
-                    cout << valueRepresentation(firstCharArray[i], 8) << " ";
+                    cout << byteRepresentation(firstCharArray[i], 8) << " ";
                 }
                 cout << endl;
                 break;
@@ -376,7 +1774,7 @@ int representation(int argc, char ** argv)
                 cout << _E(_("Decimal: "));
                 for (uint i = 0; i < nbOfBytesInFirstChar; i++)
                 {
-                    cout << valueRepresentation(firstCharArray[i], 10) << " ";
+                    cout << byteRepresentation(firstCharArray[i], 10) << " ";
                 }
                 cout << endl;
                 break;
@@ -410,11 +1808,6 @@ int representation(int argc, char ** argv)
                 cout << _E(_("To title: ")) << (const char*) dst << endl;
             }
                 break;
-            case 'h':
-                representationShowHelp();
-                return 0;
-            case '?':
-                return 50; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
             default:
                 break;
         }
@@ -436,9 +1829,66 @@ int properties(int argc, char ** argv)
         }
     }
     
+    vector<int> selectors;
+    bool all = false;
+    bool showStats = false;
+    string format("tsv");
+    StreamOptions streamOptions;
+    while (1) {
+        const int opt = getopt_long(argc, argv, "lucdibaf:I:zSRD", propertiesOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'a':
+                all = true;
+                break;
+            case 'f':
+                format = optarg;
+                break;
+            case 'I':
+                streamOptions.input = optarg;
+                all = true;
+                break;
+            case 'z':
+                streamOptions.delimiter = '\0';
+                all = true;
+                break;
+            case 'S':
+                showStats = true;
+                all = true;
+                break;
+            case 'R':
+                streamOptions.repair = REPAIR_REPLACE;
+                break;
+            case 'D':
+                streamOptions.repair = REPAIR_DROP;
+                break;
+            case '?':
+                return 50; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
+            default:
+                selectors.push_back(opt);
+                break;
+        }
+    }
+    
+    u7::PropertiesOptions rowOptions;
+    const int formatStatus = formatArgument(format, rowOptions.format);
+    if (formatStatus)
+        return formatStatus;
+    if (all)
+    {
+        StatsReport report(showStats, "properties", false, streamOptions);
+        rowOptions.columns = columns<u7::Property>(selectors, PROPERTIES_COLUMNS);
+        return codepointRows(rowOptions, streamOptions);
+    }
+    
     utf8proc_int32_t codepoint = 0;
     string input;
     cin >> input;
+    repairInput(input, streamOptions.repair);
     const utf8proc_uint8_t * inputArray = (const utf8proc_uint8_t *) input.c_str();
     // This stops at the first codepoint; with 'عَ', the first retrieved codepoint is 'ع'.
     utf8proc_ssize_t nb = utf8proc_iterate(&inputArray[0], -1, &codepoint);
@@ -456,67 +1906,345 @@ int properties(int argc, char ** argv)
     }
     firstCharArray[nbOfBytesInFirstChar] = '\0';
     
-    option longopts[] = {
-        {"islower", no_argument, 0, 'l'},
-        {"isupper", no_argument, 0, 'u'},
-        {"category", no_argument, 0, 'c'},
-        {"direction", no_argument, 0, 'd'},
-        {"decompositiontype", no_argument, 0, 'i'}, // decompos'i'tion
-        {"boundclass", no_argument, 0, 'b'},
-        {0}};
-        
-        while (1) {
-            const int opt = getopt_long(argc, argv, "lucdib", longopts, 0);
-            
-            if (opt == -1) {
-                break;
-            }
-            
-            switch (opt) {
-                case 'l':
-                    cout << _E(_("Is lower: ")) << utf8proc_islower(codepoint) << endl;
-                    break;
-                case 'u':
-                    cout << _E(_("Is upper: ")) << utf8proc_isupper(codepoint) << endl;
-                    break;
-                case 'c':
+    // In the order of u7::Property.
+    const char * const labels[] = {_("Is lower: "), _("Is upper: "), _("Category: "), _("Direction: "),
+                                   _("Decomposition type: "), _("Bound class: ")};
+    string value;
+    for (u7::Property column : columns<u7::Property>(selectors, PROPERTIES_COLUMNS))
+    {
+        value.clear();
+        u7::property(codepoint, column, value);
+        cout << _E(labels[column]) << value << endl;
+    }
+    // Show the processed character.
+    cout << _E(_("Character: ")) << (const char*) firstCharArray << endl;
+    return 0;
+}
+
+/*
+ * A request of serve mode, parsed once per distinct ARGS by each connection.
+ */
+struct ServeRequest
+{
+    string mode;
+    // Non-zero if the request cannot be served, 'message' telling why.
+    int status = 0;
+    string message;
+    u7::UnaccentOptions unaccent;
+    u7::NormalizeOptions normalize;
+    u7::CaseOptions letterCase;
+    u7::SearchKeyOptions searchKey;
+    u7::SegmentOptions segment;
+    u7::RepresentationOptions representation;
+    u7::PropertiesOptions properties;
+    InputRepair repair = REPAIR_NONE;
+};
+
+// getopt is not reentrant.
+mutex serveParseMutex;
+
+ServeRequest parseServeRequest(string_view args)
+{
+    ServeRequest request;
+    vector<string> tokens;
+    size_t start = 0;
+    while ((start = args.find_first_not_of(" \t", start)) != string_view::npos)
+    {
+        const size_t end = min(args.find_first_of(" \t", start), args.size());
+        tokens.emplace_back(args.substr(start, end - start));
+        start = end;
+    }
+    if (tokens.empty())
+    {
+        request.status = 20;
+        request.message = _("A mode of operation is required: unaccent, normalize, case, searchkey, segment, representation, properties.");
+        return request;
+    }
+    request.mode = tokens[0];
+    const option * longopts = NULL;
+    const char * shortopts = NULL;
+    int invalidStatus = 0;
+    if (request.mode == "unaccent")
+    {
+        longopts = unaccentOptions;
+        shortopts = "icmnrsj:I:O:zSk:f:d:qRDh";
+        invalidStatus = 30;
+    }
+    else if (request.mode == "normalize")
+    {
+        longopts = normalizeOptions;
+        shortopts = "t:sj:I:O:zSk:f:d:qcRDh";
+        invalidStatus = 40;
+    }
+    else if (request.mode == "case")
+    {
+        longopts = caseOptions;
+        shortopts = "LUTCsj:I:O:zSf:d:qRDh";
+        invalidStatus = 70;
+    }
+    else if (request.mode == "searchkey")
+    {
+        longopts = searchKeyOptions;
+        shortopts = "wsj:I:O:zSf:d:qRDh";
+        invalidStatus = 90;
+    }
+    else if (request.mode == "segment")
+    {
+        longopts = segmentOptions;
+        shortopts = "w:I:O:zSRDh";
+        invalidStatus = 80;
+    }
+    else if (request.mode == "representation")
+    {
+        longopts = representationOptions;
+        shortopts = "pesbodxLUTaf:I:zSRD";
+        invalidStatus = 50;
+    }
+    else if (request.mode == "properties")
+    {
+        longopts = propertiesOptions;
+        shortopts = "lucdibaf:I:zSRD";
+        invalidStatus = 50;
+    }
+    else
+    {
+        request.status = 20;
+        request.message = _("Unknown mode: ") + request.mode;
+        return request;
+    }
+    
+    vector<char*> argv;
+    for (string& token : tokens)
+        argv.push_back(token.data());
+    argv.push_back(NULL);
+    string type("NFC");
+    string format("tsv");
+    vector<int> selectors;
+    lock_guard<mutex> lock(serveParseMutex);
+    optind = 0; // Rescan from the start.
+    opterr = 0;
+    while (request.status == 0)
+    {
+        const int opt = getopt_long(argv.size() - 1, argv.data(), shortopts, longopts, 0);
+        if (opt == -1)
+            break;
+        if (opt == '?')
+        {
+            request.status = invalidStatus;
+            request.message = _("Invalid option: ") + string(argv[optind - 1]);
+            break;
+        }
+        if (opt == 'R' || opt == 'D')
+        {
+            request.repair = (opt == 'R') ? REPAIR_REPLACE : REPAIR_DROP;
+            continue;
+        }
+        bool available = true;
+        if (request.mode == "unaccent")
+        {
+            if (strchr("icmnr", opt))
+                unaccentFlag(opt, request.unaccent);
+            else
+                available = false;
+        }
+        else if (request.mode == "normalize")
+        {
+            if (opt == 't')
+                type = optarg;
+            else
+                available = false;
+        }
+        else if (request.mode == "case")
+        {
+            if (strchr("LUTC", opt))
+                caseFlag(opt, request.letterCase);
+            else
+                available = false;
+        }
+        else if (request.mode == "searchkey")
+        {
+            if (opt == 'w')
+                request.searchKey.collapseSpaces = true;
+            else
+                available = false;
+        }
+        else if (request.mode == "segment")
+        {
+            if (opt == 'w')
+            {
+                const long width = widthArgument(optarg);
+                if (width < 0)
                 {
-                    utf8proc_category_t category = utf8proc_category(codepoint);
-                    cout << _E(_("Category: ")) << "[" << utf8proc_category_string(codepoint) << "] ";
-                    cout << categoryDescription[category] << endl;
+                    request.status = 81;
+                    request.message = _("Invalid width.");
+                    break;
                 }
+                request.segment.width = width;
+            }
+            else
+            {
+                available = false;
+            }
+        }
+        else
+        {
+            if (opt == 'f')
+                format = optarg;
+            else if (strchr("IzS", opt))
+                available = false;
+            else if (opt != 'a') // Implied.
+                selectors.push_back(opt);
+        }
+        if (!available)
+        {
+            request.status = 63;
+            request.message = _("Option not available in serve mode: ") + string(1, '-') + char(opt);
+        }
+    }
+    if (request.status)
+        return request;
+    
+    if (request.mode == "normalize")
+    {
+        if (!u7::normalizationForm(type, request.normalize.form))
+        {
+            request.status = 41;
+            request.message = _("Unknown type; valid types are NFC, NFD, NFKC, NFKD and NFKC_Casefold.");
+        }
+    }
+    else if (request.mode == "representation" || request.mode == "properties")
+    {
+        u7::RowFormat rowFormat = u7::ROW_TSV;
+        if (format == "json")
+        {
+            rowFormat = u7::ROW_JSON;
+        }
+        else if (format != "tsv")
+        {
+            request.status = 52;
+            request.message = _("Unknown format: ") + format;
+        }
+        request.representation.format = request.properties.format = rowFormat;
+        request.representation.columns = columns<u7::Representation>(selectors, REPRESENTATION_COLUMNS);
+        request.properties.columns = columns<u7::Property>(selectors, PROPERTIES_COLUMNS);
+    }
+    return request;
+}
+
+int serveRequest(const ServeRequest& request, string_view payload, string& result)
+{
+    if (request.status)
+    {
+        result += request.message;
+        return request.status;
+    }
+    if (request.repair != REPAIR_NONE && u7::validPrefix(payload) != payload.size())
+    {
+        // The offsets are not reported.
+        thread_local string repaired;
+        repaired.clear();
+        u7::RepairOptions repairOptions;
+        repairOptions.drop = (request.repair == REPAIR_DROP);
+        u7::repair(payload, repairOptions, repaired);
+        payload = repaired;
+    }
+    utf8proc_ssize_t nb = 0;
+    if (request.mode == "unaccent")
+    {
+        nb = u7::unaccent(payload, request.unaccent, result);
+    }
+    else if (request.mode == "normalize")
+    {
+        if (u7::unchanged(payload, request.normalize))
+            result += payload;
+        else
+            nb = u7::normalize(payload, request.normalize, result);
+    }
+    else if (request.mode == "case")
+    {
+        nb = u7::mapCase(payload, request.letterCase, result);
+    }
+    else if (request.mode == "searchkey")
+    {
+        nb = u7::searchKey(payload, request.searchKey, result);
+    }
+    else if (request.mode == "segment")
+    {
+        nb = u7::segment(payload, request.segment, result);
+    }
+    else if (request.mode == "representation")
+    {
+        nb = u7::representation(payload, request.representation, result);
+    }
+    else
+    {
+        nb = u7::properties(payload, request.properties, result);
+    }
+    if (nb < 0) // an error occured
+    {
+        result = utf8proc_errmsg(nb);
+        return nb * -1;
+    }
+    return 0;
+}
+
+// Distinct ARGS remembered by a connection.
+#define SERVE_CACHED_REQUESTS 256
+
+int serve(int argc, char ** argv)
+{
+    ServeOptions options;
+    while (1) {
+        const int opt = getopt_long(argc, argv, "lS:h", serveOptions, 0);
+        
+        if (opt == -1) {
+            break;
+        }
+        
+        switch (opt) {
+            case 'l':
+                options.framing = SERVE_LENGTH;
                 break;
-                case 'd':
-                {
-                    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
-                    cout << _E(_("Direction: ") )<< bidirectional[property->bidi_class] << endl;
-                }
+            case 'S':
+                options.socket = optarg;
                 break;
-                case 'i':
-                {
-                    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
-                    cout << _E(_("Decomposition type: ")) << decompositionType[property->decomp_type] << endl;
-                }
+            case 'h':
+                serveShowHelp();
+                return 0;
+            case '?':
+                return 60;
+            default:
                 break;
-                case 'b':
+        }
+    }
+    
+    return serveRequests([]()
+    {
+        struct Cache
+        {
+            unordered_map<string, ServeRequest> requests;
+            string lastArgs;
+            const ServeRequest * last = NULL;
+        };
+        shared_ptr<Cache> cache = make_shared<Cache>();
+        return [cache](string_view args, string_view payload, string& result)
+        {
+            if (!cache->last || args != cache->lastArgs)
+            {
+                string key(args);
+                auto it = cache->requests.find(key);
+                if (it == cache->requests.end())
                 {
-                    // property->boundclass is 1 (other) on all tested characters.
-                    const utf8proc_property_t * property = utf8proc_get_property(codepoint);
-                    cout << _E(_("Bound class: ")) << boundClass[property->boundclass] << endl;
+                    if (cache->requests.size() >= SERVE_CACHED_REQUESTS)
+                        cache->requests.clear();
+                    it = cache->requests.emplace(key, parseServeRequest(args)).first;
                 }
-                break;
-                case 'h':
-                    representationShowHelp();
-                    return 0;
-                case '?':
-                    return 50; // -5 to -1 are reserved by utf8proc; their absolute values are used here.
-                default:
-                    break;
+                cache->lastArgs = std::move(key);
+                cache->last = &it->second;
             }
-        }
-        // Show the processed character.
-        cout << _E(_("Character: ")) << (const char*) firstCharArray << endl;
-        return 0;
+            return serveRequest(*cache->last, payload, result);
+        };
+    }, options);
 }
 
 int main(int argc, char ** argv)
@@ -526,109 +2254,14 @@ int main(int argc, char ** argv)
     bindtextdomain (_APPNAME_, "/usr/local/share/locale"); // containing <language_code>/LC_MESSAGES/
     textdomain (_APPNAME_);
     
-    // Translatable, but we won't do it on our own.
-    categoryDescription[UTF8PROC_CATEGORY_CN] = _("Other, not assigned");
-    categoryDescription[UTF8PROC_CATEGORY_LU] = _("Letter, uppercase");
-    categoryDescription[UTF8PROC_CATEGORY_LL] = _("Letter, lowercase");
-    categoryDescription[UTF8PROC_CATEGORY_LT] = _("Letter, titlecase");
-    categoryDescription[UTF8PROC_CATEGORY_LM] = _("Letter, modifier");
-    categoryDescription[UTF8PROC_CATEGORY_LO] = _("Letter, other");
-    categoryDescription[UTF8PROC_CATEGORY_MN] = _("Mark, nonspacing");
-    categoryDescription[UTF8PROC_CATEGORY_MC] = _("Mark, spacing combining");
-    categoryDescription[UTF8PROC_CATEGORY_ME] = _("Mark, enclosing");
-    categoryDescription[UTF8PROC_CATEGORY_NL] = _("Number, letter");
-    categoryDescription[UTF8PROC_CATEGORY_NO] = _("Number, other");
-    categoryDescription[UTF8PROC_CATEGORY_PC] = _("Punctuation, connector");
-    categoryDescription[UTF8PROC_CATEGORY_PD] = _("Punctuation, dash");
-    categoryDescription[UTF8PROC_CATEGORY_PS] = _("Punctuation, open");
-    categoryDescription[UTF8PROC_CATEGORY_PE] = _("Punctuation, close");
-    categoryDescription[UTF8PROC_CATEGORY_PI] = _("Punctuation, initial quote");
-    categoryDescription[UTF8PROC_CATEGORY_PF] = _("Punctuation, final quote");
-    categoryDescription[UTF8PROC_CATEGORY_PO] = _("Punctuation, other");
-    categoryDescription[UTF8PROC_CATEGORY_SM] = _("Symbol, math");
-    categoryDescription[UTF8PROC_CATEGORY_SC] = _("Symbol, currency");
-    categoryDescription[UTF8PROC_CATEGORY_SK] = _("Symbol, modifier");
-    categoryDescription[UTF8PROC_CATEGORY_SO] = _("Symbol, other");
-    categoryDescription[UTF8PROC_CATEGORY_ZS] = _("Separator, space");
-    categoryDescription[UTF8PROC_CATEGORY_ZL] = _("Separator, line");
-    categoryDescription[UTF8PROC_CATEGORY_ZP] = _("Separator, paragraph");
-    categoryDescription[UTF8PROC_CATEGORY_CC] = _("Other, control");
-    categoryDescription[UTF8PROC_CATEGORY_CF] = _("Other, format");
-    categoryDescription[UTF8PROC_CATEGORY_CS] = _("Other, surrogate");
-    categoryDescription[UTF8PROC_CATEGORY_CO] = _("Other, private use");
-    
-    bidirectional[UTF8PROC_BIDI_CLASS_L] = _("Left-to-Right");
-    bidirectional[UTF8PROC_BIDI_CLASS_LRE] = _("Left-to-Right Embedding");
-    bidirectional[UTF8PROC_BIDI_CLASS_LRO] = _("Left-to-Right Override");
-    bidirectional[UTF8PROC_BIDI_CLASS_R] = _("Right-to-Left");
-    bidirectional[UTF8PROC_BIDI_CLASS_AL] = _("Right-to-Left Arabic");
-    bidirectional[UTF8PROC_BIDI_CLASS_RLE] = _("Right-to-Left Embedding");
-    bidirectional[UTF8PROC_BIDI_CLASS_RLO] = _("Right-to-Left Override");
-    bidirectional[UTF8PROC_BIDI_CLASS_PDF] = _("Pop Directional Format");
-    bidirectional[UTF8PROC_BIDI_CLASS_EN] = _("European Number");
-    bidirectional[UTF8PROC_BIDI_CLASS_ES] = _("European Separator");
-    bidirectional[UTF8PROC_BIDI_CLASS_ET] = _("European Number Terminator");
-    bidirectional[UTF8PROC_BIDI_CLASS_AN] = _("Arabic Number");
-    bidirectional[UTF8PROC_BIDI_CLASS_CS] = _("Common Number Separator");
-    bidirectional[UTF8PROC_BIDI_CLASS_NSM] = _("Nonspacing Mark");
-    bidirectional[UTF8PROC_BIDI_CLASS_BN] = _("Boundary Neutral");
-    bidirectional[UTF8PROC_BIDI_CLASS_B] = _("Paragraph Separator");
-    bidirectional[UTF8PROC_BIDI_CLASS_S] = _("Segment Separator");
-    bidirectional[UTF8PROC_BIDI_CLASS_WS] = _("Whitespace");
-    bidirectional[UTF8PROC_BIDI_CLASS_ON] = _("Other Neutrals");
-    bidirectional[UTF8PROC_BIDI_CLASS_LRI] = _("Left-to-Right Isolate");
-    bidirectional[UTF8PROC_BIDI_CLASS_RLI] = _("Right-to-Left Isolate");
-    bidirectional[UTF8PROC_BIDI_CLASS_FSI] = _("First Strong Isolate");
-    bidirectional[UTF8PROC_BIDI_CLASS_PDI] = _("Pop Directional Isolate");
-    
-    // Whatever it means! But does it concern decomposed form only?
-    decompositionType[0] = _("Unknown"); // property->decomp_type is 0 on all tested characters, decomposed or not.
-    decompositionType[UTF8PROC_DECOMP_TYPE_FONT] = _("Font"); // Starts at 1.
-    decompositionType[UTF8PROC_DECOMP_TYPE_NOBREAK] = _("Nobreak");
-    decompositionType[UTF8PROC_DECOMP_TYPE_INITIAL] = _("Initial");
-    decompositionType[UTF8PROC_DECOMP_TYPE_MEDIAL] = _("Medial");
-    decompositionType[UTF8PROC_DECOMP_TYPE_FINAL] = _("Final");
-    decompositionType[UTF8PROC_DECOMP_TYPE_ISOLATED] = _("Isolated");
-    decompositionType[UTF8PROC_DECOMP_TYPE_CIRCLE] = _("Circle");
-    decompositionType[UTF8PROC_DECOMP_TYPE_SUPER] = _("Super");
-    decompositionType[UTF8PROC_DECOMP_TYPE_SUB] = _("Sub");
-    decompositionType[UTF8PROC_DECOMP_TYPE_VERTICAL] = _("Vertical");
-    decompositionType[UTF8PROC_DECOMP_TYPE_WIDE] = _("Wide");
-    decompositionType[UTF8PROC_DECOMP_TYPE_NARROW] = _("Narrow");
-    decompositionType[UTF8PROC_DECOMP_TYPE_SMALL] = _("Small");
-    decompositionType[UTF8PROC_DECOMP_TYPE_SQUARE] = _("Square");
-    decompositionType[UTF8PROC_DECOMP_TYPE_FRACTION] = _("Fraction");
-    decompositionType[UTF8PROC_DECOMP_TYPE_COMPAT] = _("Compat");
-    
-    // Whatever most values mean!
-    boundClass[UTF8PROC_BOUNDCLASS_START] =  _("Start");
-    boundClass[UTF8PROC_BOUNDCLASS_OTHER] =  _("Other");
-    boundClass[UTF8PROC_BOUNDCLASS_CR] =  _("Cr");
-    boundClass[UTF8PROC_BOUNDCLASS_LF] =  _("Lf");
-    boundClass[UTF8PROC_BOUNDCLASS_CONTROL] =  _("Control");
-    boundClass[UTF8PROC_BOUNDCLASS_EXTEND] =  _("Extend");
-    boundClass[UTF8PROC_BOUNDCLASS_L] =  _("L");
-    boundClass[UTF8PROC_BOUNDCLASS_V] =  _("V");
-    boundClass[UTF8PROC_BOUNDCLASS_T] =  _("T");
-    boundClass[UTF8PROC_BOUNDCLASS_LV] =  _("Lv");
-    boundClass[UTF8PROC_BOUNDCLASS_LVT] = _("Lvt");
-    boundClass[UTF8PROC_BOUNDCLASS_REGIONAL_INDICATOR] = _("Regional indicator");
-    boundClass[UTF8PROC_BOUNDCLASS_SPACINGMARK] = _("Spacingmark");
-    boundClass[UTF8PROC_BOUNDCLASS_PREPEND] = _("Prepend");
-    boundClass[UTF8PROC_BOUNDCLASS_ZWJ] = _("Zero Width Joiner");
-    boundClass[UTF8PROC_BOUNDCLASS_E_BASE] = _("Emoji Base");
-    boundClass[UTF8PROC_BOUNDCLASS_E_MODIFIER] = _("Emoji Modifier");
-    boundClass[UTF8PROC_BOUNDCLASS_GLUE_AFTER_ZWJ] = _("Glue_After_ZWJ");
-    boundClass[UTF8PROC_BOUNDCLASS_E_BASE_GAZ] = _("E_BASE + GLUE_AFTER_ZJW");
-    boundClass[UTF8PROC_BOUNDCLASS_EXTENDED_PICTOGRAPHIC] = _("Extended_Pictographic");
-    boundClass[UTF8PROC_BOUNDCLASS_E_ZWG] = _("UTF8PROC_BOUNDCLASS_EXTENDED_PICTOGRAPHIC + ZWJ");
-    
-    const char * modeInfo = _("A mode of operation is required: unaccent, normalize, representation, properties, about."
-     "\nPass '--help' for more information in each mode.");
+    const bool allocationCount = (getenv("UTF8UTIL_ALLOCATION_COUNT") != NULL);
+    if (allocationCount)
+        startAllocationCount();
+    
     const int sargc = argc - 1;
     if (sargc == 0)
     {
-        cout << modeInfo << endl;
+        modeShowInfo();
         return 20;
     }
     char * sargv[sargc];
@@ -654,6 +2287,26 @@ int main(int argc, char ** argv)
     {
         ret = normalize(sargc, sargv);
     }
+    else if (mode == "case")
+    {
+        ret = letterCase(sargc, sargv);
+    }
+    else if (mode == "searchkey")
+    {
+        ret = searchKey(sargc, sargv);
+    }
+    else if (mode == "segment")
+    {
+        ret = segment(sargc, sargv);
+    }
+    else if (mode == "transcode")
+    {
+        ret = transcode(sargc, sargv);
+    }
+    else if (mode == "stats")
+    {
+        ret = stats(sargc, sargv);
+    }
     else if (mode == "representation")
     {
         ret = representation (sargc, sargv);
@@ -662,6 +2315,10 @@ int main(int argc, char ** argv)
     {
         ret = properties(sargc, sargv);
     }
+    else if (mode == "serve")
+    {
+        ret = serve(sargc, sargv);
+    }
     else if (mode == "about")
     {
         cout << "Author: Saleem Edah-Tally [Surgeon, Hobbyist developer]"
@@ -671,9 +2328,15 @@ int main(int argc, char ** argv)
     }
     else
     {
-        cout << modeInfo << endl;
+        modeShowInfo();
         return 20;
     }
     
+    if (allocationCount)
+    {
+        const AllocationCounters counters = allocationCounters();
+        cerr << _("Allocations: ") << counters.allocations << " (" << counters.bytes << _(" bytes)") << endl;
+    }
+    
     return ret;
 }